@@ -1,6 +1,8 @@
 #ifndef JACK_COMP_H
 #define JACK_COMP_H
 
+#include <setjmp.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #define EXEC_SUCCESS 0
@@ -12,6 +14,60 @@
 
 #define TAB_WIDTH 8
 
+#define DEFAULT_INLINE_THRESHOLD 8
+#define DEFAULT_MAX_ERRORS 20
+
+typedef struct compilerOptions {
+	int inlineThreshold; /* Maximum number of terms in the body of an inlined subroutine, 0 disables inlining */
+	int maxErrors; /* Errors reported before the compiler gives up, 0 for no limit */
+	bool hoistInvariants; /* Move loop-invariant computations in front of while loops */
+	bool trackArrayBase; /* Reuse the address held in pointer 1 across accesses to the same array */
+	bool eliminateTailCalls; /* Turn self-recursive calls in return statements into jumps */
+	bool packLocals; /* Share local slots between variables whose lifetimes do not overlap */
+	bool intrinsics; /* Expand calls of small OS subroutines such as Memory.peek in place */
+	bool poolStrings; /* Build each distinct string literal of a class once and keep it in a static slot */
+	bool sizedAlloc; /* Constructors call Memory.allocN without arguments where the Memory class of the program has one */
+	bool annotateLines; /* Precede the code of every statement with a "// line N" comment for the profiler */
+	bool sourceMap; /* Write a Class.vm.map next to every Class.vm mapping its instructions to source lines */
+	bool emitBytecode; /* Write every class as a .vmb bytecode file instead of a textual .vm file */
+	bool lexOnly; /* Stop after lexing every source file and report the lexer throughput */
+	bool dumpTokens; /* Print every token while lexing, implies lexOnly */
+	bool parseOnly; /* Stop after parsing every source file and report the parser throughput */
+	bool checkOnly; /* Generate code only to find semantic errors and warnings, nothing is written */
+	bool replaceChanged; /* Only write outputs whose content changed, through a temporary file renamed over the old one */
+	char * outputDirectory; /* Directory all .vm files are written to, overrides writing them next to their sources */
+	char * linkFile; /* Single .vm or .asm file the whole program is linked into instead of one .vm per class, NULL to disable */
+	char * costReportFile; /* Where to write the estimated size and cycle count of every function, NULL for no report */
+} compilerOptions;
+
+/* A source file waiting to be compiled, outputDirectory is NULL for the current directory */
+
+typedef struct compileJob {
+	char * sourcePath;
+	char * outputDirectory;
+	struct compileJob * nextJob;
+} compileJob;
+
+/* Errors and warnings go to the handler instead of stderr while one is set, errors then jump back to errorRecovery instead of exiting */
+
+typedef enum diagnosticSeverity { severityError = 1, severityWarning = 2 } diagnosticSeverity;
+typedef void (* diagnosticHandler)(diagnosticSeverity severity, const char * message, int lineNum);
+
+extern diagnosticHandler diagnosticHook;
+extern jmp_buf * errorRecovery;
+
+void raiseDiagnostic(diagnosticSeverity severity, const char * message, int lineNum);
+
+/* Without a handler the parser and code generator set errorRecovery themselves, and resynchronise there to report further errors */
+
+extern unsigned int errorCount;
+extern int errorStatus;
+
+bool countError(int status);
+
 extern FILE * sourceFile;
+extern char * sourceFileName;
+extern char * outputDirectory;
+extern compilerOptions options;
 
 #endif
\ No newline at end of file
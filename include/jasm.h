@@ -0,0 +1,20 @@
+#ifndef JASM_H
+#define JASM_H
+
+#include <stdio.h>
+
+#define MAX_ASM_NAME 256
+#define ASM_STATIC_BASE 16
+#define ASM_STATIC_END 256
+
+/* Translation of VM commands to Hack assembly, static indices are expected to be relocated program wide already */
+
+void translateBootstrap(FILE * asmFile, const char * entry);
+void translateCommand(FILE * asmFile, const char * line);
+void translatePush(FILE * asmFile, const char * segment, int index);
+void translatePop(FILE * asmFile, const char * segment, int index);
+void translateComparison(FILE * asmFile, const char * jump);
+void translateCall(FILE * asmFile, const char * function, int argumentCount);
+void translateReturn(FILE * asmFile);
+
+#endif
\ No newline at end of file
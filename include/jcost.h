@@ -0,0 +1,53 @@
+#ifndef JCOST_H
+#define JCOST_H
+
+#include <stdbool.h>
+
+#define CALL_ROM_WORDS 42 /* Saving the caller frame, repositioning ARG and LCL and jumping */
+#define RETURN_ROM_WORDS 42 /* Restoring the caller frame and jumping to the return address */
+#define LOCAL_ROM_WORDS 4 /* Pushing a zero for every local in the function prologue */
+
+/* Cost of one VM command after translation to Hack, cycles count the instructions executed on the path through it */
+
+typedef struct vmCost {
+	const char * command;
+	const char * segment; /* NULL matches any segment */
+	int romWords;
+	int cycles;
+} vmCost;
+
+typedef struct pathCost {
+	long bestCycles;
+	long worstCycles;
+} pathCost;
+
+/* Operand stack depth recorded for a jump target so the depth is known again where the label is placed */
+
+typedef struct labelDepth {
+	char * label;
+	int depth;
+	struct labelDepth * nextLabel;
+} labelDepth;
+
+typedef struct functionCost {
+	char * className;
+	char * functionName;
+	long romWords;
+	long bestCycles;
+	long worstCycles;
+	int maxStack; /* Deepest the operand stack gets above the locals of the function */
+	struct functionCost * nextFunction;
+} functionCost;
+
+void beginFunctionCost(const char * qualifiedName);
+void recordCommand(const char * line);
+void recordStackEffect(const char * command, const char * argument, int count);
+void recordLabelDepth(const char * label);
+void freeLabelDepths();
+pathCost currentPathCost();
+void setPathCost(pathCost cost);
+void mergePathCosts(pathCost first, pathCost second);
+void writeCostReport(const char * filename);
+void freeCostReport();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef JDEV_H
+#define JDEV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Memory mapped devices of the Hack platform, shared by the VM runner and the emulator for unattended runs */
+
+#define DEVICE_SCREEN 16384
+#define DEVICE_KEYBOARD 24576
+#define SCREEN_WIDTH 512
+#define SCREEN_HEIGHT 256
+#define SCREEN_ROW_WORDS (SCREEN_WIDTH / 16)
+
+/* Times are counted in whatever the caller runs, VM instructions for jvm and cycles for jemu */
+
+typedef struct keyEvent {
+	long time;
+	int16_t key; /* Value of the keyboard register from then on, 0 once the key is released */
+} keyEvent;
+
+void loadKeyTrace(const char * fileName);
+void parseScreenDumps(const char * list);
+long nextDeviceEvent();
+void processDeviceEvents(int16_t * memory, long time);
+void finishDevices(int16_t * memory, long time);
+void resetDevices();
+void writeScreen(const int16_t * memory, const char * fileName);
+void freeDevices();
+
+#endif
\ No newline at end of file
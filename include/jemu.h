@@ -0,0 +1,73 @@
+#ifndef JEMU_H
+#define JEMU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HACK_ROM_SIZE 32768
+#define HACK_RAM_SIZE 32768
+#define HACK_ADDRESS_MASK 0x7FFF
+#define HACK_VARIABLE_BASE 16
+#define MAX_ASM_LINE_SIZE 512
+
+#define DEST_M 1
+#define DEST_D 2
+#define DEST_A 4
+
+#define JUMP_POSITIVE 1
+#define JUMP_ZERO 2
+#define JUMP_NEGATIVE 4
+
+/* Computed goto needs the GNU labels as values extension, other compilers get a switch */
+
+#if defined(__GNUC__) && !defined(JEMU_SWITCH_DISPATCH)
+#define HACK_COMPUTED_GOTO
+#endif
+
+/* Every distinct computation of a C-instruction has its own handler, the order matches the handler table of the emulator */
+
+typedef enum hackOperations {
+	hackLoad, hackHalt, hackEnd,
+	hackZero, hackOne, hackMinusOne, hackD, hackA, hackM, hackNotD, hackNotA, hackNotM, hackNegD, hackNegA, hackNegM,
+	hackDPlusOne, hackAPlusOne, hackMPlusOne, hackDMinusOne, hackAMinusOne, hackMMinusOne,
+	hackDPlusA, hackDPlusM, hackDMinusA, hackDMinusM, hackAMinusD, hackMMinusD, hackDAndA, hackDAndM, hackDOrA, hackDOrM,
+	hackOperationCount
+} hackOperation;
+
+typedef enum hackStops { stopHalt, stopEnd, stopCycles, stopWatch } hackStop;
+
+typedef struct hackInstruction {
+	uint8_t operation;
+	uint8_t destination;
+	uint8_t jump; /* Signs of the result the instruction jumps on */
+	int16_t value; /* Constant loaded by an A-instruction */
+} hackInstruction;
+
+typedef struct hackComputation {
+	const char * mnemonic;
+	uint8_t bits; /* The a bit followed by c1 to c6 */
+	hackOperation operation;
+} hackComputation;
+
+typedef struct hackSymbol {
+	char * name;
+	int value;
+} hackSymbol;
+
+/* Functions for loading Hack programs */
+
+void loadHackFile(const char * fileName);
+void loadAssemblyFile(const char * fileName);
+int assembleInstruction(char * line, int lineNum, const char * fileName);
+void addHackSymbol(hackSymbol ** symbols, int * symbolCount, int * symbolCapacity, const char * name, int value);
+int lookupHackSymbol(const char * name);
+void decodeProgram();
+
+/* Functions for running Hack programs */
+
+void resetMachine();
+hackStop runMachine(long maxCycles);
+hackStop runWithDevices(long maxCycles);
+void printReport(hackStop reason);
+
+#endif
\ No newline at end of file
@@ -6,18 +6,81 @@
 #include "../include/jsym.h"
 #include "../include/jparse.h"
 
+#define LABEL_SIZE 32
+#define MAX_COMMAND_SIZE 512
+
+typedef struct pooledString {
+	char * literal;
+	int slot;
+	struct pooledString * nextString;
+} pooledString;
+
+typedef struct sourceRun {
+	int start; /* Index of the first VM instruction of the run within its file */
+	int count;
+	int lineNum;
+} sourceRun;
+
+typedef struct arrayBase {
+	variableSymbol * array; /* NULL when pointer 1 does not hold a known address */
+	variableSymbol * index; /* NULL when the index is a constant */
+	int displacement;
+} arrayBase;
+
+/* OS subroutine whose calls are replaced by an expansion, the callee is the declaration found in the compiled OS class */
+
+typedef struct intrinsic {
+	const char * className;
+	const char * functionName;
+	unsigned int argumentCount;
+	bool pushesValue;
+	void (* expand)(functionCall * call, functionSymbolTable * callee);
+} intrinsic;
+
+void emit(const char * format, ...);
+void processEmittedText(const char * text);
 void generateCode();
 void processClass(classSymbolTable * currentClass);
+void discardOutput();
+void abandonClass();
+void abandonStatement();
 void processFunction(functionSymbolTable * currentFunction);
 bool processStatements(statement * currentStatement);
 bool processIfStatement(statement * currentStatement);
 void processLetStatement(statement * currentStatement);
 void processWhileStatement(statement * currentStatement);
+size_t saveInitialised();
+void restoreInitialised(size_t state);
 void processReturnStatement(statement * currentStatement);
+void processTailCall(functionCall * call);
 void processDoStatement(statement * currentStatement);
 char * processExpression(expression * currentExpression);
+void processCondition(expression * condition, bool jumpIfTrue, const char * label);
+void processConditionTerm(term * curTerm, bool jumpIfTrue, const char * label);
+bool isBooleanExpression(expression * curExpression);
+bool isBooleanTerm(term * curTerm);
+bool isNegatedCondition(expression * condition);
+bool isConstantCondition(expression * condition);
 void processOperator(char operator);
 char * processTerm(term * curTerm);
 char * processFunctionCall(functionCall * call);
+const intrinsic * lookupIntrinsic(functionCall * call, functionSymbolTable ** callee);
+void expandPeek(functionCall * call, functionSymbolTable * callee);
+void expandPoke(functionCall * call, functionSymbolTable * callee);
+void expandAbs(functionCall * call, functionSymbolTable * callee);
+void expandMin(functionCall * call, functionSymbolTable * callee);
+void expandMax(functionCall * call, functionSymbolTable * callee);
+bool decomposeIndex(expression * indexExpression, variableSymbol ** index, int * displacement);
+int reuseArrayBase(variableSymbol * curVariable, expression * indexExpression);
+void recordArrayBase(variableSymbol * curVariable, expression * indexExpression);
+void invalidateArrayBase();
+void processStringLiteral(char * literal);
+int poolStringLiteral(char * literal);
+void recordSourceLine(const char * line);
+void processSourceMap(const char * filename);
+bool replaceOutput(FILE * generated, const char * filename);
+void freeSourceMap();
+void processStringPool();
+void freeStringPool();
 
 #endif
\ No newline at end of file
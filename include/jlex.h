@@ -22,7 +22,12 @@ extern const char * const operators;
 extern const char * const punctuators;
 extern const char * const tokenTypeNames[];
 
+void loadSource(FILE * file);
+void loadSourceText(const char * text, size_t length);
+void freeSource();
+const char * scannerName();
 void getNextToken(token * currToken);
 void peekNextToken(token * currToken);
+void ungetToken(token * currToken);
 
 #endif
\ No newline at end of file
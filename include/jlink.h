@@ -0,0 +1,28 @@
+#ifndef JLINK_H
+#define JLINK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define MAX_STATIC_COUNT 240 /* RAM[16] to RAM[255] */
+
+typedef enum linkFormats { linkText, linkAssembly, linkBytecode } linkFormat;
+
+/* Subroutine of the linked image, in the order it was generated */
+
+typedef struct linkedFunction {
+	char * name;
+	char * text; /* Its commands, static indices already relocated into the program wide static segment */
+	size_t length;
+	size_t capacity;
+	bool placed;
+} linkedFunction;
+
+void collectLinkedClass(const char * className, FILE * classFile);
+void appendLinkedText(linkedFunction * curFunction, const char * text);
+linkedFunction * lookupLinkedFunction(const char * name);
+void linkProgram(const char * filename);
+void placeFunction(linkedFunction * curFunction, FILE * linkFile, linkFormat format);
+void freeLinkedProgram();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef JLSP_H
+#define JLSP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../include/jack.h"
+
+/* Language server over stdin and stdout, documents are kept in full and the class of a changed document is reparsed on its own */
+
+#define LSP_HEADER_SIZE 256
+
+typedef struct lspDiagnostic {
+	diagnosticSeverity severity;
+	char * message;
+	int lineNum;
+	struct lspDiagnostic * nextDiagnostic;
+} lspDiagnostic;
+
+/* Text built up for an outgoing message */
+
+typedef struct jsonBuffer {
+	char * text;
+	size_t length;
+	size_t capacity;
+} jsonBuffer;
+
+int runLanguageServer(char ** paths, int pathCount);
+char * readMessage();
+void writeMessage(jsonBuffer * body);
+bool handleMessage(const char * message);
+void loadWorkspace(const char * path);
+void checkDocument(const char * path, const char * text, size_t length);
+void publishDiagnostics(const char * uri);
+void collectDiagnostic(diagnosticSeverity severity, const char * message, int lineNum);
+void freeDiagnostics();
+
+/* Minimal JSON reading and writing for the protocol messages */
+
+const char * skipJsonValue(const char * value);
+const char * findJsonMember(const char * object, const char * path);
+char * readJsonString(const char * value);
+void appendJson(jsonBuffer * buffer, const char * format, ...);
+void appendJsonString(jsonBuffer * buffer, const char * string);
+
+#endif
\ No newline at end of file
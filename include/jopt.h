@@ -0,0 +1,118 @@
+#ifndef JOPT_H
+#define JOPT_H
+
+#include <stdbool.h>
+
+#include "../include/jsym.h"
+#include "../include/jparse.h"
+
+/* Side effects of evaluating code, used by the purity analysis */
+
+#define EFFECT_NONE 0
+#define EFFECT_READS_STATE 1 /* Reads fields, statics or memory through arrays */
+#define EFFECT_WRITES_STATE 2 /* Writes fields, statics or memory, or allocates */
+#define EFFECT_MAY_NOT_RETURN 4 /* May loop forever or halt the program */
+#define EFFECT_ALL (EFFECT_READS_STATE | EFFECT_WRITES_STATE | EFFECT_MAY_NOT_RETURN)
+
+typedef struct osEffect {
+	const char * className;
+	const char * functionName;
+	int effects;
+} osEffect;
+
+typedef struct nameList {
+	char ** names;
+	unsigned int count;
+} nameList;
+
+typedef struct hoistedExpression {
+	expression * value;
+	char * name;
+	struct hoistedExpression * nextExpression;
+} hoistedExpression;
+
+typedef struct localLiveness {
+	int firstPosition; /* Position of the first statement referencing the variable, -1 if it is never referenced */
+	int lastPosition;
+	int definitionList; /* Statement list holding the assignment which precedes every read, -1 if there is none */
+	int * positions;
+	unsigned int positionCount;
+} localLiveness;
+
+typedef struct loopRange {
+	int start;
+	int end;
+} loopRange;
+
+typedef struct inlinedCall {
+	char * caller;
+	char * callee;
+	int lineNum;
+	struct inlinedCall * nextCall;
+} inlinedCall;
+
+/* Functions for measuring and inspecting expressions */
+
+unsigned int countExpressionTerms(expression * curExpression);
+unsigned int countTermSize(term * curTerm);
+unsigned int countVariableUses(expression * curExpression, char * variableName);
+unsigned int expressionStackDepth(expression * curExpression);
+unsigned int pairStackDepth(expression * curExpression, unsigned int leftDepth, unsigned int rightDepth);
+unsigned int termStackDepth(term * curTerm);
+bool canSwapOperands(expression * curExpression);
+bool expressionHasCalls(expression * curExpression);
+bool termHasCalls(term * curTerm);
+bool isSimpleExpression(expression * curExpression);
+
+/* Functions for deciding which subroutines can be inlined */
+
+bool isInlineCandidate(classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics);
+bool isInlineableExpression(expression * curExpression, classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics);
+bool isInlineableTerm(term * curTerm, classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics);
+
+/* Functions for the purity analysis of subroutines */
+
+functionSymbolTable * resolveCall(functionCall * call, classSymbolTable * curClass, functionSymbolTable * curFunction, classSymbolTable ** calleeClass);
+int functionEffects(classSymbolTable * curClass, functionSymbolTable * curFunction);
+int callEffects(functionCall * call, classSymbolTable * curClass, functionSymbolTable * curFunction);
+int statementEffects(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction);
+int expressionEffects(expression * curExpression, classSymbolTable * curClass, functionSymbolTable * curFunction);
+int termEffects(term * curTerm, classSymbolTable * curClass, functionSymbolTable * curFunction);
+
+/* Functions for loop-invariant code motion */
+
+void hoistLoopInvariants(classSymbolTable * curClass, functionSymbolTable * curFunction);
+void hoistStatementInvariants(statement ** link);
+void hoistWhileInvariants(statement ** link);
+void hoistExpressionInvariants(expression * curExpression);
+void hoistTermInvariants(term * curTerm);
+bool isLoopInvariantExpression(expression * curExpression);
+bool isLoopInvariantTerm(term * curTerm);
+void collectAssignedVariables(statement * curStatement, nameList * assigned);
+bool expressionsEqual(expression * first, expression * second);
+bool termsEqual(term * first, term * second);
+variableSymbol * newTemporaryVariable(functionSymbolTable * curFunction);
+
+/* Functions for the liveness analysis of local variables */
+
+void analyseLiveness(functionSymbolTable * curFunction);
+int analyseStatementList(statement * curStatement);
+void analyseStatement(statement * curStatement, int list);
+void analyseExpression(expression * curExpression, int position);
+void analyseTerm(term * curTerm, int position);
+void recordReference(char * variableName, int position, int list, bool isDefinition);
+int packLocalVariables(functionSymbolTable * curFunction);
+void freeLiveness();
+
+/* Functions for tail call elimination */
+
+bool isSelfTailCall(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction);
+bool hasSelfTailCall(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction);
+
+/* Functions for reporting inlined call sites */
+
+void recordInlinedCall(classSymbolTable * callerClass, functionSymbolTable * caller, classSymbolTable * calleeClass, functionSymbolTable * callee, int lineNum);
+void printInlineReport();
+void freeInlineReport();
+
+#endif
\ No newline at end of file
@@ -12,10 +12,22 @@ typedef enum statementTypes { ifStatement, doStatement, whileStatement, varState
 typedef enum constantTypes { integerType, stringType, keywordType } constantType; 
 typedef enum termTypes { funcCall, expr, constant, reference, unaryTerm, arrayReference } termType;
 
+/* Operand and argument lists start out in storage inside their node and only move out into the node pool, doubling each time, when they outgrow it */
+
+#define INLINE_OPERANDS 4
+#define INLINE_ARGUMENTS 4
+
+/* Expressions are stored in postfix order, each operator applies to the two values before it. Jack evaluates strictly from left to right, so "a - b * c" is stored as "a b - c *" */
+
+#define POSTFIX_OPERAND '\0' /* Postfix entry which pushes the next term */
+#define FIRST_OPERATOR(curExpression) ((curExpression)->postfix[2]) /* Operator of the first two terms, the postfix of several terms always starts with them */
+
 typedef struct functionCall {
 	char * actionName;
 	struct expression ** expressionList;
 	unsigned int expressionCount;
+	unsigned int argumentCapacity;
+	struct expression * argumentStorage[INLINE_ARGUMENTS];
 } functionCall;
 
 typedef struct term {
@@ -49,10 +61,13 @@ typedef struct type{
 } type;
 
 typedef struct expression {
-	char * operators;
-	term ** terms;
-	unsigned int operatorCount;
+	char * postfix; /* POSTFIX_OPERAND for every term and the operators between them, in the order they are evaluated */
+	term ** terms; /* In the order the postfix pushes them */
+	unsigned int postfixLength;
 	unsigned int termCount;
+	unsigned int termCapacity; /* The postfix has room for twice as many entries, an expression never has more operators than terms */
+	term * termStorage[INLINE_OPERANDS];
+	char postfixStorage[2 * INLINE_OPERANDS];
 } expression;
 
 typedef struct statement {
@@ -87,8 +102,24 @@ typedef struct statement {
 	struct statement * nextStatement;
 } statement;
 
+/* Parse tree nodes of a subroutine are carved out of large zeroed blocks owned by the subroutine, so the whole tree is released at once and a node costs no allocator header */
+
+#define NODE_BLOCK_SIZE 4096
+
+typedef struct nodeBlock {
+	struct nodeBlock * nextBlock;
+	size_t used;
+	size_t size;
+	void * storage[]; /* Pointer sized slots keep every node suitably aligned */
+} nodeBlock;
+
+typedef struct nodePool {
+	nodeBlock * blocks; /* Most recently started block first */
+} nodePool;
+
 /* Recursive decent functions */
 
+bool reparseClass(); /* Syntax errors only return false when a diagnostic hook is installed, they end the compiler otherwise */
 void parseClass();
 void parseClassVarDeclaration();
 void parseSubroutineDeclaration();
@@ -107,6 +138,13 @@ expression * parseExpression();
 term * parseTerm();
 void parseType();
 
+/* For allocating nodes from the pool of the current subroutine */
+
+nodePool * newNodePool();
+void * allocateNode(size_t size);
+char * copyNodeString(const char * string);
+void freeNodePool(nodePool * pool);
+
 /* For creating and modifying new statements */
 
 statement * newStatement();
@@ -121,21 +159,18 @@ statement * newWhileStatement();
 expression * newExpression();
 void addOperator(expression * curExpression, char operator);
 void addTerm(expression * curExpression, term * curTerm);
+void moveOperands(expression * destination, expression * source);
+void addArgument(functionCall * call, expression * argument);
 
 /* For creating and modifying new terms */
 
 term * newTerm();
 void addConst(term * curTerm, char * constant);
 
-/* For cleanup after the parse tree is no longer needed */
-
-void freeStatement(statement * currentStatement);
-void freeExpression(expression * currentExpression);
-void freeTerm(term * currentTerm);
-
 /* Handling of errors and tokens during the parsing phase */
 
 void syntaxError(char * expected, token currToken);
 void syntaxOkay(token currToken);
+bool isKeywordToken(token currToken, const char * word);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef JSCAN_H
+#define JSCAN_H
+
+#include <stddef.h>
+
+/* Zeroed bytes after the end of a loaded source, so block scanners may read a whole block past the last character */
+
+#define SCAN_PADDING 64
+
+/* Scanners for the runs of whitespace and comments between tokens, lines counts the newlines passed over */
+
+typedef struct sourceScanner {
+	const char * name;
+	size_t (* skipWhitespace)(const char * buffer, size_t position, size_t length, int * lines);
+	size_t (* findLineEnd)(const char * buffer, size_t position, size_t length);
+	size_t (* findCommentEnd)(const char * buffer, size_t position, size_t length, int * lines); /* Position after the closing star and slash */
+} sourceScanner;
+
+const sourceScanner * selectScanner();
+
+#endif
\ No newline at end of file
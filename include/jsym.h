@@ -13,6 +13,8 @@ typedef enum variableConstructions { primitive, array, structure } variableConst
 typedef struct variableSymbol {
 	bool isArgument;
 	bool initialised;
+	bool isTemporary; /* Introduced by an optimisation pass rather than declared in the source */
+	bool definedBeforeUse; /* Always assigned before it is read, so it does not rely on the VM zeroing its slot */
 	char * name;
 	char * typeName;
 	int offset;
@@ -30,10 +32,14 @@ typedef struct functionSymbolTable {
 	int variableCount;
 	int offset;
 	int lineNum;
+	int effects; /* Side effects of calling the function, see jopt.h */
+	bool effectsKnown;
+	bool effectsPending;
 	struct functionSymbolTable * nextFunction;
 	struct classSymbolTable * typeClass;
 	struct statement * statements;
 	struct statement * lastStatement;
+	struct nodePool * nodes; /* Storage of every parse tree node of the function */
 	functionType type;
 	variableSymbol * arguments;
 	variableSymbol * lastArgument;
@@ -43,6 +49,8 @@ typedef struct functionSymbolTable {
 
 typedef struct classSymbolTable {
 	char * name;
+	char * fileName; /* Path of the source file the class was parsed from */
+	char * outputDirectory; /* Where to write the .vm file, NULL for the current directory */
 	int staticCount;
 	int fieldCount;
 	int functionCount;
@@ -52,6 +60,8 @@ typedef struct classSymbolTable {
 	variableSymbol * lastVariable;
 	functionSymbolTable * functions;
 	functionSymbolTable * lastFunction;
+	char ** references; /* Names of the other classes looked up while finalising and generating the class */
+	unsigned int referenceCount;
 } classSymbolTable;
 
 typedef struct classList {
@@ -111,6 +121,9 @@ void verifyFunctionType(functionSymbolTable * curFunction);
 
 /* Functions which assist in the semantic analysis/code generation phase */
 
+classSymbolTable * lookupClass(const char * className);
+classSymbolTable * lookupClassFile(const char * fileName);
+bool referencesClass(classSymbolTable * curClass, const char * className);
 functionSymbolTable * lookupClassFunction(classSymbolTable * curClass, char * functionName);
 variableSymbol * lookupClassVariable(classSymbolTable * curClass, char * variableName);
 variableSymbol * lookupFunctionVariable(functionSymbolTable * curFunction, char * Variablename);
@@ -118,6 +131,7 @@ variableSymbol * lookupFunctionVariable(functionSymbolTable * curFunction, char
 /* Functions for cleaning up the symbol table and parse tree */
 
 void freeClasses();
+void removeClass(classSymbolTable * curClass);
 classSymbolTable * freeClass(classSymbolTable * curClass);
 functionSymbolTable * freeFunction(functionSymbolTable * curFunction);
 variableSymbol * freeVariable(variableSymbol * curVariable);
@@ -0,0 +1,134 @@
+#ifndef JVM_H
+#define JVM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "../include/jvmb.h"
+
+#define RUNTIME_ERROR 6
+
+#define RAM_SIZE 32768
+#define STACK_BASE 256
+#define HEAP_BASE 2048
+#define HEAP_END 16384
+#define SCREEN_BASE 16384
+#define KEYBOARD_ADDRESS 24576
+#define STATIC_BASE 16
+#define STATIC_END 256
+#define TEMP_BASE 5
+
+#define SP 0
+#define LCL 1
+#define ARG 2
+#define THIS 3
+#define THAT 4
+
+#define MAX_LINE_SIZE 512
+#define MAX_CALL_DEPTH 4096
+
+typedef int16_t (* nativeFunction)(int16_t * arguments);
+
+typedef struct nativeEntry {
+	const char * name;
+	int argumentCount;
+	nativeFunction implementation;
+} nativeEntry;
+
+typedef struct vmInstruction {
+	vmOpcode opcode;
+	vmSegment segment;
+	int argument; /* Segment index, local count or argument count */
+	int target; /* Instruction index of a jump, function index of a call */
+	int function; /* Index of the function the instruction belongs to */
+	int file;
+	int lineNum; /* Jack source line the instruction was generated from, 0 if unknown */
+	bool lineStart; /* First instruction generated for its source line */
+	char * label; /* Name of the jump target or called function until it is resolved */
+} vmInstruction;
+
+typedef struct vmFunction {
+	char * name;
+	int entry; /* Index of the function command, -1 if the function is only provided natively */
+	int file;
+	bool hasBody;
+	nativeEntry * native; /* Built-in replacement used when the function has no body */
+	long calls;
+	long inclusive;
+	long exclusive;
+	int activeCount; /* Number of activations on the call stack, so recursion is only counted once inclusively */
+	long entryCount;
+} vmFunction;
+
+typedef struct vmFile {
+	char * className;
+	char * sourceName; /* Jack file named by the source map, NULL if the file has none */
+	int firstInstruction;
+	int staticBase;
+	int staticCount;
+} vmFile;
+
+typedef struct vmLabel {
+	char * name; /* Qualified with the function it appears in */
+	int index;
+} vmLabel;
+
+typedef struct vmFrame {
+	int returnIndex;
+	int function;
+	long entryCount;
+	struct stackNode * node;
+} vmFrame;
+
+/* Node of the tree of distinct call stacks, counts are the instructions executed with exactly this stack */
+
+typedef struct stackNode {
+	int function;
+	long count;
+	struct stackNode * parent;
+	struct stackNode * firstChild;
+	struct stackNode * nextSibling;
+} stackNode;
+
+/* Functions for loading VM programs */
+
+void loadPath(const char * path);
+void loadFile(const char * fileName);
+void parseLine(char * line, int file, int * lineNum, bool * lineStart);
+void addInstruction(vmOpcode opcode, vmSegment segment, int argument, const char * name, int file, int * lineNum, bool * lineStart);
+void loadBytecode(const char * fileName, int file);
+void loadSourceMap(const char * fileName, int file);
+int addFunction(const char * name);
+int lookupFunction(const char * name);
+void addLabel(const char * name, int index);
+int lookupLabel(const char * name);
+void resolveProgram();
+
+/* Functions for running VM programs */
+
+void runProgram(long maxSteps);
+void executeProgram(long maxSteps);
+int16_t callProgram(int function, const int16_t * arguments, int argumentCount);
+void callFunction(int function, int argumentCount, int returnIndex);
+void returnFromFunction();
+void runtimeError(const char * message);
+int16_t * segmentAddress(vmSegment segment, int index, int file);
+
+/* Functions for profiling */
+
+stackNode * enterStackNode(stackNode * parent, int function);
+void writeProfile(const char * baseName);
+void writeFoldedStacks(FILE * profileFile, stackNode * node, const char * path);
+void freeStackNodes(stackNode * node);
+
+/* Built-in implementation of the Jack OS, jvmos.c */
+
+extern int16_t ram[RAM_SIZE];
+extern bool running;
+
+nativeEntry * lookupNative(const char * name);
+void initNativeOS();
+void initProgramOS();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef JVMB_H
+#define JVMB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Binary form of a .vm file, a header followed by fixed width instructions and a string table, all in host byte order */
+
+#define VMB_MAGIC "JVMB"
+#define VMB_VERSION 1
+#define VMB_LINE 255 /* Opcode of a "// line N" annotation, which is not an instruction */
+#define VMB_MAX_ARGUMENT 255
+#define VMB_MAX_OPERAND 65535
+
+typedef enum vmOpcodes { opPush, opPop, opAdd, opSub, opNeg, opEq, opGt, opLt, opAnd, opOr, opNot, opLabel, opGoto, opIfGoto, opFunction, opCall, opReturn } vmOpcode;
+typedef enum vmSegments { segConstant, segLocal, segArgument, segThis, segThat, segPointer, segTemp, segStatic, segNone } vmSegment;
+
+typedef struct vmbHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t instructionCount;
+	uint32_t stringTableSize;
+} vmbHeader;
+
+typedef struct vmbInstruction {
+	uint8_t opcode;
+	uint8_t argument; /* Segment of push and pop, local count of function, argument count of call */
+	uint16_t operand; /* Segment index or line number, string table offset of the name of a label or function */
+} vmbInstruction;
+
+/* Bytecode of one file while it is being encoded */
+
+typedef struct vmbBuffer {
+	vmbInstruction * instructions;
+	uint32_t instructionCount;
+	uint32_t instructionCapacity;
+	char * strings;
+	uint32_t stringTableSize;
+	uint32_t stringTableCapacity;
+} vmbBuffer;
+
+extern const char * vmCommandNames[];
+extern const char * vmSegmentNames[];
+
+void encodeCommand(vmbBuffer * buffer, const char * line);
+uint16_t encodeString(vmbBuffer * buffer, const char * string);
+void writeBytecode(vmbBuffer * buffer, FILE * vmbFile);
+void freeBytecode(vmbBuffer * buffer);
+const vmbHeader * mapBytecode(const char * fileName, size_t * size);
+void unmapBytecode(const vmbHeader * header, size_t size);
+void decodeInstruction(FILE * vmFile, const vmbInstruction * instruction, const char * strings);
+
+#endif
\ No newline at end of file
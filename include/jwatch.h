@@ -0,0 +1,37 @@
+#ifndef JWATCH_H
+#define JWATCH_H
+
+#include <stdbool.h>
+
+#include "../include/jack.h"
+
+/* Watch mode keeps the symbol tables of every class in memory and only reparses, finalises and generates what a change affects */
+
+#define WATCH_DEBOUNCE_MS 100 /* Quiet time after the last event before rebuilding, editors often save a file in several steps */
+#define WATCH_BUFFER_SIZE 4096
+
+typedef struct watchedDirectory {
+	int descriptor;
+	char * path;
+	char * fileName; /* Only this file of the directory is watched, NULL for every .jack file in it */
+	char * outputDirectory; /* NULL for the current directory */
+	struct watchedDirectory * nextDirectory;
+} watchedDirectory;
+
+/* Source file which changed since the last build */
+
+typedef struct sourceChange {
+	char * path;
+	char * outputDirectory;
+	struct sourceChange * nextChange;
+} sourceChange;
+
+int watchSources(compileJob * jobs, char ** paths, int pathCount);
+void addWatch(int notifier, const char * path);
+void readEvents(int notifier);
+void recordChange(const char * path, const char * changeOutputDirectory);
+void rebuildChanged(bool everything);
+void reportDiagnostic(diagnosticSeverity severity, const char * message, int lineNum);
+void freeWatches();
+
+#endif
\ No newline at end of file
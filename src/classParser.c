@@ -1,3 +1,4 @@
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,14 +12,72 @@ extern classList classes;
 extern classSymbolTable * currentClass;
 extern functionSymbolTable * currentFunction;
 extern variableSymbol * currentVariable;
+extern nodePool * currentNodePool;
+
+bool reparseClass()
+{
+	jmp_buf recovery;
+	jmp_buf * previousRecovery = errorRecovery;
+	classSymbolTable * previousClass = classes.lastClass;
+	classSymbolTable * oldClass;
+	bool parsed;
+
+	/* The class parsed from the same file before is only replaced once the new source parses, until then the other classes keep seeing it */
+
+	errorRecovery = &recovery;
+
+	if(!setjmp(recovery)) {
+		parseClass();
+		parsed = true;
+	} else {
+		parsed = false;
+	}
+
+	errorRecovery = previousRecovery;
+	currentNodePool = NULL;
+
+	if(!parsed) {
+		if(classes.lastClass != previousClass)
+			removeClass(classes.lastClass);
+
+		return false;
+	}
+
+	while(sourceFileName && (oldClass = lookupClassFile(sourceFileName)) != classes.lastClass)
+		removeClass(oldClass);
+
+	return true;
+}
+
+static bool skipDeclaration()
+{
+	token currToken;
+
+	/* Panic mode at class level, everything up to the next class variable or subroutine declaration is dropped */
+
+	for(;;) {
+		peekNextToken(&currToken);
+
+		if(currToken.type == terminator)
+			return false;
+
+		if(isKeywordToken(currToken, "field") || isKeywordToken(currToken, "static") || isKeywordToken(currToken, "constructor") || isKeywordToken(currToken, "function") || isKeywordToken(currToken, "method"))
+			return true;
+
+		getNextToken(&currToken);
+		syntaxOkay(currToken);
+	}
+}
 
 void parseClass()
 {
 	token currToken;
+	jmp_buf recovery;
+	jmp_buf * previousRecovery = errorRecovery;
 
 	getNextToken(&currToken);
 
-	if(strcmp(currToken.string, "class"))
+	if(!isKeywordToken(currToken, "class"))
 		syntaxError("Keyword \"class\"", currToken);
 
 	syntaxOkay(currToken);
@@ -36,6 +95,19 @@ void parseClass()
 
 	syntaxOkay(currToken);
 
+	/* Errors the statements could not recover from end up here, a subroutine keeps what was parsed of it before the error */
+
+	if(!diagnosticHook)
+		errorRecovery = &recovery;
+
+	if(setjmp(recovery) && !skipDeclaration()) { /* The rest of the class, including its closing brace, was skipped */
+		errorRecovery = previousRecovery;
+		currentClass = NULL;
+		currentFunction = NULL;
+
+		return;
+	}
+
 	for(;;) {
 		peekNextToken(&currToken);
 
@@ -43,9 +115,9 @@ void parseClass()
 			getNextToken(&currToken);
 			syntaxOkay(currToken);
 			break;
-		} else if(!strcmp(currToken.string, "field") || !strcmp(currToken.string, "static")) {
+		} else if(isKeywordToken(currToken, "field") || isKeywordToken(currToken, "static")) {
 			parseClassVarDeclaration();
-		} else if(!strcmp(currToken.string, "constructor") || !strcmp(currToken.string, "function") || !strcmp(currToken.string, "method")) {
+		} else if(isKeywordToken(currToken, "constructor") || isKeywordToken(currToken, "function") || isKeywordToken(currToken, "method")) {
 			break;
 		} else {
 			syntaxError("Class variable or subroutine", currToken);
@@ -59,7 +131,7 @@ void parseClass()
 			getNextToken(&currToken);
 			syntaxOkay(currToken);
 			break;
-		} else if(!strcmp(currToken.string, "constructor") || !strcmp(currToken.string, "function") || !strcmp(currToken.string, "method")) {
+		} else if(isKeywordToken(currToken, "constructor") || isKeywordToken(currToken, "function") || isKeywordToken(currToken, "method")) {
 			parseSubroutineDeclaration();
 		} else {
 			syntaxError("Class variable or subroutine", currToken);
@@ -73,6 +145,7 @@ void parseClass()
 
 	syntaxOkay(currToken);
 
+	errorRecovery = previousRecovery;
 	currentClass = NULL;
 
 	return;
@@ -86,10 +159,11 @@ void parseClassVarDeclaration()
 	getNextToken(&currToken);
 
 	curVariable = newVariableSymbol();
+	curVariable->lineNum = currToken.lineNum;
 
-	if(!strcmp(currToken.string, "field"))
+	if(isKeywordToken(currToken, "field"))
 		curVariable->type = field;
-	else if(!strcmp(currToken.string, "static"))
+	else if(isKeywordToken(currToken, "static"))
 		curVariable->type = statik;
 	else
 		syntaxError("Keyword \"field\" or \"static\"", currToken);
@@ -116,6 +190,7 @@ void parseClassVarDeclaration()
 				syntaxOkay(currToken);
 
 				curVariable = newVariableSymbol();
+				curVariable->lineNum = currToken.lineNum;
 				curVariable->type = currentClass->lastVariable->type;
 
 				setVariableTypeName(curVariable, currentClass->lastVariable->typeName);
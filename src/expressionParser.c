@@ -13,7 +13,7 @@ void parseType()
 
 	peekNextToken(&currToken);
 
-	if(	currToken.type != identifier && strcmp(currToken.string, "int") && strcmp(currToken.string, "char") && strcmp(currToken.string, "boolean"))
+	if(	currToken.type != identifier && !isKeywordToken(currToken, "int") && !isKeywordToken(currToken, "char") && !isKeywordToken(currToken, "boolean"))
 		syntaxError("Identifier or variable type", currToken);
 
 	return;
@@ -45,7 +45,7 @@ term * parseTerm()
 
 		return curTerm;
 	} else if(currToken.type == keyword) {
-		if(strcmp(currToken.string, "true") && strcmp(currToken.string, "false") && strcmp(currToken.string, "null") && strcmp(currToken.string, "this"))
+		if(!isKeywordToken(currToken, "true") && !isKeywordToken(currToken, "false") && !isKeywordToken(currToken, "null") && !isKeywordToken(currToken, "this"))
 			syntaxError("Keyword \"true\", \"false\", \"null\", or \"this\"", currToken);
 
 		curTerm->type = constant;
@@ -56,14 +56,9 @@ term * parseTerm()
 
 		return curTerm;
 	} else if(currToken.type == identifier) {
-		char * name;
+		char * name = copyNodeString(currToken.string);
+		char * qualifiedName;
 
-		if(!(name = calloc(strlen(currToken.string) + 1, 1))) {
-			fprintf(stderr, "Error: Cannot allocate memory for identifier!\n");
-			exit(MEM_ERROR);
-		}
-
-		strncpy(name, currToken.string, strlen(currToken.string));
 		syntaxOkay(currToken);
 		peekNextToken(&currToken);
 
@@ -96,19 +91,12 @@ term * parseTerm()
 			if(currToken.type != identifier)
 				syntaxError("Identifier", currToken);
 
-			if(!(curTerm->call = calloc(sizeof(functionCall), 1))) {
-				fprintf(stderr, "Error: Could not allocate memory for subroutine call!\n");
-				exit(MEM_ERROR);
-			}
+			curTerm->call = allocateNode(sizeof(functionCall));
 
-			if(!(name = realloc(name, strlen(name) + strlen(currToken.string) + 2))) {
-				fprintf(stderr, "Error: Could not allocate memory for subroutine name!\n");
-				exit(MEM_ERROR);
-			}
+			qualifiedName = allocateNode(strlen(name) + strlen(currToken.string) + 2);
+			sprintf(qualifiedName, "%s.%s", name, currToken.string);
 
-			snprintf(name + strlen(name), strlen(currToken.string) + 2, ".%s", currToken.string);
-		
-			curTerm->call->actionName = name;
+			curTerm->call->actionName = qualifiedName;
 
 			syntaxOkay(currToken);
 			getNextToken(&currToken);
@@ -126,11 +114,7 @@ term * parseTerm()
 				syntaxError("\'(\'", currToken);
 			}
 		} else if(currToken.character == '(') {
-			if(!(curTerm->call = calloc(sizeof(functionCall), 1))) {
-				fprintf(stderr, "Error: Could not allocate memory for subroutine call!\n");
-				exit(MEM_ERROR);
-			}
-
+			curTerm->call = allocateNode(sizeof(functionCall));
 			curTerm->type = funcCall;
 			curTerm->call->actionName = name;
 
@@ -184,6 +168,7 @@ expression * parseExpression()
 	token currToken;
 	expression * newExpr;
 	term * newTerm;
+	char curOperator;
 
 	if(!(newTerm = parseTerm()))
 		return NULL;
@@ -197,13 +182,14 @@ expression * parseExpression()
 
 		if(currToken.type == operator) {
 			getNextToken(&currToken);
-			addOperator(newExpr, currToken.character);
+			curOperator = currToken.character;
 			syntaxOkay(currToken);
 
 			if(!(newTerm = parseTerm()))
 				syntaxError("Term expected after operator", currToken);
 
 			addTerm(newExpr, newTerm);
+			addOperator(newExpr, curOperator);
 		} else {
 			break;
 		}
@@ -222,26 +208,16 @@ void parseExpressionList(functionCall * call)
 	if(currToken.type == punctuator && currToken.character == ')')
 		return;
 
-	if(!(call->expressionList = calloc(1, sizeof(expression *)))) {
-		fprintf(stderr, "Error: Could not allocate memory for expression list!\n");
-		exit(MEM_ERROR);
-	}
-
-	call->expressionList[0] = parseExpression();
+	addArgument(call, parseExpression());
 
-	for(call->expressionCount = 1;; call->expressionCount++) {
+	for(;;) {
 		peekNextToken(&currToken);
 
 		if(currToken.type == punctuator && currToken.character == ',') {
 			getNextToken(&currToken);
 			syntaxOkay(currToken);
 
-			if(!(call->expressionList = realloc(call->expressionList, (call->expressionCount + 1) * sizeof(expression *)))) {
-				fprintf(stderr, "Error: Could not allocate memory for expression list!\n");
-				exit(MEM_ERROR);
-			}
-
-			call->expressionList[call->expressionCount] = parseExpression();
+			addArgument(call, parseExpression());
 		} else if(currToken.type == punctuator && currToken.character == ')') {
 			break;
 		} else {
@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jasm.h"
+
+/* Function the translated commands belong to, labels are scoped by it */
+
+char asmFunction[MAX_ASM_NAME] = "BOOTSTRAP";
+int asmLabelID = 0;
+
+static const char * segmentPointer(const char * segment)
+{
+	if(!strcmp(segment, "local"))
+		return "LCL";
+	else if(!strcmp(segment, "argument"))
+		return "ARG";
+	else if(!strcmp(segment, "this"))
+		return "THIS";
+	else if(!strcmp(segment, "that"))
+		return "THAT";
+
+	return NULL;
+}
+
+static int fixedAddress(const char * segment, int index)
+{
+	int address = -1;
+
+	if(!strcmp(segment, "static"))
+		address = ASM_STATIC_BASE + index;
+	else if(!strcmp(segment, "temp") && index < 8)
+		address = 5 + index;
+	else if(!strcmp(segment, "pointer") && index < 2)
+		address = 3 + index;
+
+	if(address < 0 || address >= ASM_STATIC_END) {
+		fprintf(stderr, "Error: Invalid segment access \"%s %d\" in %s!\n", segment, index, asmFunction);
+		exit(SEMANTIC_ERROR);
+	}
+
+	return address;
+}
+
+void translateBootstrap(FILE * asmFile, const char * entry)
+{
+	/* The halt loop behind the call catches a return from the entry point */
+
+	fprintf(asmFile, "// bootstrap\n@256\nD=A\n@SP\nM=D\n");
+	translateCall(asmFile, entry, 0);
+	fprintf(asmFile, "(BOOTSTRAP$halt)\n@BOOTSTRAP$halt\n0;JMP\n");
+
+	return;
+}
+
+void translateCommand(FILE * asmFile, const char * line)
+{
+	char command[16] = { 0 };
+	char argument[MAX_ASM_NAME] = { 0 };
+	int index = 0;
+
+	if(sscanf(line, "%15s %255s %d", command, argument, &index) < 1)
+		return;
+
+	if(!strncmp(command, "//", 2)) { /* Line annotations are kept for anyone reading the assembly */
+		fprintf(asmFile, "%s\n", line);
+		return;
+	}
+
+	if(!strcmp(command, "push")) {
+		translatePush(asmFile, argument, index);
+	} else if(!strcmp(command, "pop")) {
+		translatePop(asmFile, argument, index);
+	} else if(!strcmp(command, "add")) {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\nA=A-1\nM=D+M\n");
+	} else if(!strcmp(command, "sub")) {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\nA=A-1\nM=M-D\n");
+	} else if(!strcmp(command, "and")) {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\nA=A-1\nM=D&M\n");
+	} else if(!strcmp(command, "or")) {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\nA=A-1\nM=D|M\n");
+	} else if(!strcmp(command, "neg")) {
+		fprintf(asmFile, "@SP\nA=M-1\nM=-M\n");
+	} else if(!strcmp(command, "not")) {
+		fprintf(asmFile, "@SP\nA=M-1\nM=!M\n");
+	} else if(!strcmp(command, "eq")) {
+		translateComparison(asmFile, "JEQ");
+	} else if(!strcmp(command, "gt")) {
+		translateComparison(asmFile, "JGT");
+	} else if(!strcmp(command, "lt")) {
+		translateComparison(asmFile, "JLT");
+	} else if(!strcmp(command, "label")) {
+		fprintf(asmFile, "(%s$%s)\n", asmFunction, argument);
+	} else if(!strcmp(command, "goto")) {
+		fprintf(asmFile, "@%s$%s\n0;JMP\n", asmFunction, argument);
+	} else if(!strcmp(command, "if-goto")) {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\n@%s$%s\nD;JNE\n", asmFunction, argument);
+	} else if(!strcmp(command, "function")) {
+		strcpy(asmFunction, argument);
+		fprintf(asmFile, "(%s)\n", asmFunction);
+
+		for(int i = 0; i < index; i++)
+			fprintf(asmFile, "@SP\nAM=M+1\nA=A-1\nM=0\n");
+	} else if(!strcmp(command, "call")) {
+		translateCall(asmFile, argument, index);
+	} else if(!strcmp(command, "return")) {
+		translateReturn(asmFile);
+	} else {
+		fprintf(stderr, "Error: Unknown VM command \"%s\" in %s!\n", command, asmFunction);
+		exit(SEMANTIC_ERROR);
+	}
+
+	return;
+}
+
+void translatePush(FILE * asmFile, const char * segment, int index)
+{
+	const char * pointer = segmentPointer(segment);
+
+	if(pointer)
+		fprintf(asmFile, "@%s\nD=M\n@%d\nA=D+A\nD=M\n", pointer, index);
+	else if(!strcmp(segment, "constant"))
+		fprintf(asmFile, "@%d\nD=A\n", index);
+	else
+		fprintf(asmFile, "@%d\nD=M\n", fixedAddress(segment, index));
+
+	fprintf(asmFile, "@SP\nAM=M+1\nA=A-1\nM=D\n");
+
+	return;
+}
+
+void translatePop(FILE * asmFile, const char * segment, int index)
+{
+	const char * pointer = segmentPointer(segment);
+
+	if(pointer) {
+		fprintf(asmFile, "@%s\nD=M\n@%d\nD=D+A\n@R13\nM=D\n@SP\nAM=M-1\nD=M\n@R13\nA=M\nM=D\n", pointer, index);
+	} else if(!strcmp(segment, "constant")) {
+		fprintf(stderr, "Error: Cannot pop to the constant segment in %s!\n", asmFunction);
+		exit(SEMANTIC_ERROR);
+	} else {
+		fprintf(asmFile, "@SP\nAM=M-1\nD=M\n@%d\nM=D\n", fixedAddress(segment, index));
+	}
+
+	return;
+}
+
+void translateComparison(FILE * asmFile, const char * jump)
+{
+	/* The result slot is preset to true and only cleared when the jump is not taken */
+
+	fprintf(asmFile, "@SP\nAM=M-1\nD=M\nA=A-1\nD=M-D\nM=-1\n@%s$cmp.%d\nD;%s\n@SP\nA=M-1\nM=0\n(%s$cmp.%d)\n", asmFunction, asmLabelID, jump, asmFunction, asmLabelID);
+	asmLabelID++;
+
+	return;
+}
+
+void translateCall(FILE * asmFile, const char * function, int argumentCount)
+{
+	static const char * const savedPointers[] = { "LCL", "ARG", "THIS", "THAT" };
+
+	fprintf(asmFile, "@%s$ret.%d\nD=A\n@SP\nAM=M+1\nA=A-1\nM=D\n", asmFunction, asmLabelID);
+
+	for(unsigned int i = 0; i < sizeof(savedPointers) / sizeof(savedPointers[0]); i++)
+		fprintf(asmFile, "@%s\nD=M\n@SP\nAM=M+1\nA=A-1\nM=D\n", savedPointers[i]);
+
+	fprintf(asmFile, "@SP\nD=M\n@%d\nD=D-A\n@ARG\nM=D\n@SP\nD=M\n@LCL\nM=D\n", argumentCount + 5);
+	fprintf(asmFile, "@%s\n0;JMP\n(%s$ret.%d)\n", function, asmFunction, asmLabelID);
+	asmLabelID++;
+
+	return;
+}
+
+void translateReturn(FILE * asmFile)
+{
+	static const char * const restoredPointers[] = { "THAT", "THIS", "ARG", "LCL" };
+
+	/* R13 walks down the saved frame, R14 keeps the return address in case the return value overwrites it */
+
+	fprintf(asmFile, "@LCL\nD=M\n@R13\nM=D\n@5\nA=D-A\nD=M\n@R14\nM=D\n");
+	fprintf(asmFile, "@SP\nAM=M-1\nD=M\n@ARG\nA=M\nM=D\n@ARG\nD=M+1\n@SP\nM=D\n");
+
+	for(unsigned int i = 0; i < sizeof(restoredPointers) / sizeof(restoredPointers[0]); i++)
+		fprintf(asmFile, "@R13\nAM=M-1\nD=M\n@%s\nM=D\n", restoredPointers[i]);
+
+	fprintf(asmFile, "@R14\nA=M\n0;JMP\n");
+
+	return;
+}
\ No newline at end of file
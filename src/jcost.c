@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jcost.h"
+
+/* Instruction counts of the translation to Hack in jasm.c, segments addressed through a base pointer need the extra address arithmetic */
+
+static const vmCost costTable[] = {
+	{ "push", "constant", 6, 6 },
+	{ "push", "static", 6, 6 },
+	{ "push", "temp", 6, 6 },
+	{ "push", "pointer", 6, 6 },
+	{ "push", NULL, 9, 9 },
+	{ "pop", "static", 5, 5 },
+	{ "pop", "temp", 5, 5 },
+	{ "pop", "pointer", 5, 5 },
+	{ "pop", NULL, 12, 12 },
+	{ "add", NULL, 5, 5 },
+	{ "sub", NULL, 5, 5 },
+	{ "and", NULL, 5, 5 },
+	{ "or", NULL, 5, 5 },
+	{ "neg", NULL, 3, 3 },
+	{ "not", NULL, 3, 3 },
+	{ "eq", NULL, 11, 11 },
+	{ "gt", NULL, 11, 11 },
+	{ "lt", NULL, 11, 11 },
+	{ "label", NULL, 0, 0 },
+	{ "goto", NULL, 2, 2 },
+	{ "if-goto", NULL, 5, 5 },
+	{ "call", NULL, CALL_ROM_WORDS, CALL_ROM_WORDS },
+	{ "return", NULL, RETURN_ROM_WORDS, RETURN_ROM_WORDS }
+};
+
+/* Commands which take two operands off the stack and leave one result */
+
+static const char * const binaryCommands[] = { "add", "sub", "and", "or", "eq", "gt", "lt" };
+
+functionCost * functionCosts = NULL;
+functionCost * lastFunctionCost = NULL;
+
+labelDepth * labelDepths = NULL;
+int stackDepth = 0;
+
+void beginFunctionCost(const char * qualifiedName)
+{
+	functionCost * curCost;
+	const char * dot = strchr(qualifiedName, '.');
+
+	if(!dot)
+		dot = qualifiedName + strlen(qualifiedName);
+
+	if(!(curCost = calloc(1, sizeof(functionCost))) || !(curCost->className = calloc(dot - qualifiedName + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for cost report!\n");
+		exit(MEM_ERROR);
+	}
+
+	memcpy(curCost->className, qualifiedName, dot - qualifiedName);
+
+	if(!(curCost->functionName = calloc(strlen(dot) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for cost report!\n");
+		exit(MEM_ERROR);
+	}
+
+	strcpy(curCost->functionName, *dot ? dot + 1 : dot);
+
+	if(!functionCosts) {
+		functionCosts = lastFunctionCost = curCost;
+	} else {
+		lastFunctionCost->nextFunction = curCost;
+		lastFunctionCost = curCost;
+	}
+
+	return;
+}
+
+void recordCommand(const char * line)
+{
+	char command[16] = { 0 };
+	char argument[256] = { 0 };
+	int count = 0;
+
+	if(sscanf(line, "%15s %255s %d", command, argument, &count) < 1)
+		return;
+
+	if(!strcmp(command, "function")) {
+		beginFunctionCost(argument);
+		lastFunctionCost->romWords = LOCAL_ROM_WORDS * count;
+		lastFunctionCost->bestCycles = lastFunctionCost->worstCycles = LOCAL_ROM_WORDS * count;
+
+		freeLabelDepths();
+		stackDepth = 0;
+
+		return;
+	}
+
+	if(!lastFunctionCost)
+		return;
+
+	recordStackEffect(command, argument, count);
+
+	for(unsigned int i = 0; i < sizeof(costTable) / sizeof(vmCost); i++) {
+		if(!strcmp(costTable[i].command, command) && (!costTable[i].segment || !strcmp(costTable[i].segment, argument))) {
+			lastFunctionCost->romWords += costTable[i].romWords;
+			lastFunctionCost->bestCycles += costTable[i].cycles;
+			lastFunctionCost->worstCycles += costTable[i].cycles;
+
+			return;
+		}
+	}
+
+	return;
+}
+
+void recordStackEffect(const char * command, const char * argument, int count)
+{
+	if(!strcmp(command, "push")) {
+		stackDepth++;
+	} else if(!strcmp(command, "pop") || !strcmp(command, "return")) {
+		stackDepth--;
+	} else if(!strcmp(command, "call")) {
+		stackDepth += 1 - count;
+	} else if(!strcmp(command, "goto") || !strcmp(command, "if-goto")) {
+		stackDepth -= !strcmp(command, "if-goto");
+		recordLabelDepth(argument);
+	} else if(!strcmp(command, "label")) {
+		/* Code after an unconditional jump is only reached through its label, which carries the depth of the jumps to it */
+
+		for(labelDepth * curLabel = labelDepths; curLabel; curLabel = curLabel->nextLabel)
+			if(!strcmp(curLabel->label, argument))
+				stackDepth = curLabel->depth;
+	} else {
+		for(unsigned int i = 0; i < sizeof(binaryCommands) / sizeof(char *); i++)
+			if(!strcmp(binaryCommands[i], command))
+				stackDepth--;
+	}
+
+	if(stackDepth > lastFunctionCost->maxStack)
+		lastFunctionCost->maxStack = stackDepth;
+
+	return;
+}
+
+void recordLabelDepth(const char * label)
+{
+	labelDepth * curLabel;
+
+	for(curLabel = labelDepths; curLabel; curLabel = curLabel->nextLabel)
+		if(!strcmp(curLabel->label, label))
+			return;
+
+	if(!(curLabel = calloc(1, sizeof(labelDepth))) || !(curLabel->label = calloc(strlen(label) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for cost report!\n");
+		exit(MEM_ERROR);
+	}
+
+	strcpy(curLabel->label, label);
+	curLabel->depth = stackDepth;
+	curLabel->nextLabel = labelDepths;
+	labelDepths = curLabel;
+
+	return;
+}
+
+void freeLabelDepths()
+{
+	labelDepth * nextLabel;
+
+	for(labelDepth * curLabel = labelDepths; curLabel; curLabel = nextLabel) {
+		nextLabel = curLabel->nextLabel;
+		free(curLabel->label);
+		free(curLabel);
+	}
+
+	labelDepths = NULL;
+
+	return;
+}
+
+pathCost currentPathCost()
+{
+	pathCost cost = { 0, 0 };
+
+	if(lastFunctionCost) {
+		cost.bestCycles = lastFunctionCost->bestCycles;
+		cost.worstCycles = lastFunctionCost->worstCycles;
+	}
+
+	return cost;
+}
+
+void setPathCost(pathCost cost)
+{
+	if(lastFunctionCost) {
+		lastFunctionCost->bestCycles = cost.bestCycles;
+		lastFunctionCost->worstCycles = cost.worstCycles;
+	}
+
+	return;
+}
+
+void mergePathCosts(pathCost first, pathCost second)
+{
+	/* After two paths join the cheapest and the most expensive of them bound the cost so far */
+
+	pathCost cost;
+
+	cost.bestCycles = first.bestCycles < second.bestCycles ? first.bestCycles : second.bestCycles;
+	cost.worstCycles = first.worstCycles > second.worstCycles ? first.worstCycles : second.worstCycles;
+
+	setPathCost(cost);
+
+	return;
+}
+
+static int compareFunctionCosts(const void * first, const void * second)
+{
+	const functionCost * a = *(const functionCost **)first;
+	const functionCost * b = *(const functionCost **)second;
+	int order;
+
+	if(a->romWords != b->romWords)
+		return a->romWords < b->romWords ? 1 : -1;
+
+	if((order = strcmp(a->className, b->className)))
+		return order;
+
+	return strcmp(a->functionName, b->functionName);
+}
+
+void writeCostReport(const char * filename)
+{
+	FILE * reportFile;
+	functionCost ** sorted;
+	functionCost ** classTotals;
+	unsigned int functionCount = 0;
+	unsigned int classCount = 0;
+
+	for(functionCost * curCost = functionCosts; curCost; curCost = curCost->nextFunction)
+		functionCount++;
+
+	if(!(sorted = calloc(functionCount + 1, sizeof(functionCost *))) || !(classTotals = calloc(functionCount + 1, sizeof(functionCost *)))) {
+		fprintf(stderr, "Error: Could not allocate memory for cost report!\n");
+		exit(MEM_ERROR);
+	}
+
+	functionCount = 0;
+
+	for(functionCost * curCost = functionCosts; curCost; curCost = curCost->nextFunction) {
+		unsigned int i;
+
+		sorted[functionCount++] = curCost;
+
+		/* Class totals reuse the cost record type with only the class name and ROM size filled in */
+
+		for(i = 0; i < classCount && strcmp(classTotals[i]->className, curCost->className); i++)
+			;
+
+		if(i == classCount) {
+			if(!(classTotals[classCount] = calloc(1, sizeof(functionCost)))) {
+				fprintf(stderr, "Error: Could not allocate memory for cost report!\n");
+				exit(MEM_ERROR);
+			}
+
+			classTotals[classCount]->className = curCost->className;
+			classTotals[classCount++]->functionName = "";
+		}
+
+		classTotals[i]->romWords += curCost->romWords;
+	}
+
+	qsort(sorted, functionCount, sizeof(functionCost *), compareFunctionCosts);
+	qsort(classTotals, classCount, sizeof(functionCost *), compareFunctionCosts);
+
+	if(!(reportFile = fopen(filename, "w"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", filename);
+		exit(FILE_ERROR);
+	}
+
+	fprintf(reportFile, "{\n\t\"functions\": [");
+
+	for(unsigned int i = 0; i < functionCount; i++)
+		fprintf(reportFile, "%s\n\t\t{ \"class\": \"%s\", \"function\": \"%s\", \"romWords\": %ld, \"bestCycles\": %ld, \"worstCycles\": %ld, \"maxStack\": %d }", i ? "," : "", sorted[i]->className, sorted[i]->functionName, sorted[i]->romWords, sorted[i]->bestCycles, sorted[i]->worstCycles, sorted[i]->maxStack);
+
+	fprintf(reportFile, "\n\t],\n\t\"classes\": [");
+
+	for(unsigned int i = 0; i < classCount; i++) {
+		fprintf(reportFile, "%s\n\t\t{ \"class\": \"%s\", \"romWords\": %ld }", i ? "," : "", classTotals[i]->className, classTotals[i]->romWords);
+		free(classTotals[i]);
+	}
+
+	fprintf(reportFile, "\n\t]\n}\n");
+	fclose(reportFile);
+
+	free(classTotals);
+	free(sorted);
+
+	return;
+}
+
+void freeCostReport()
+{
+	functionCost * nextCost;
+
+	for(functionCost * curCost = functionCosts; curCost; curCost = nextCost) {
+		nextCost = curCost->nextFunction;
+		free(curCost->className);
+		free(curCost->functionName);
+		free(curCost);
+	}
+
+	functionCosts = lastFunctionCost = NULL;
+	freeLabelDepths();
+
+	return;
+}
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jdev.h"
+
+keyEvent * keyEvents = NULL;
+int keyEventCount = 0;
+int nextKeyEvent = 0;
+
+long * dumpTimes = NULL;
+int dumpCount = 0;
+int nextDump = 0;
+bool dumpAtEnd = false;
+
+static int compareTimes(const void * first, const void * second)
+{
+	long a = *(const long *)first;
+	long b = *(const long *)second;
+
+	return a < b ? -1 : a > b;
+}
+
+void loadKeyTrace(const char * fileName)
+{
+	FILE * traceFile;
+	char line[256];
+	int lineNum = 0;
+	int capacity = 0;
+
+	if(!(traceFile = fopen(fileName, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	/* Every line holds a time and the key code held down from then on, either as a number or as a quoted character */
+
+	while(fgets(line, sizeof(line), traceFile)) {
+		long time;
+		int key;
+		char character;
+
+		lineNum++;
+
+		if(strchr(line, '#'))
+			*strchr(line, '#') = '\0';
+
+		if(sscanf(line, " %ld '%c'", &time, &character) == 2) {
+			key = character;
+		} else if(sscanf(line, " %ld %d", &time, &key) != 2) {
+			if(strspn(line, " \t\r\n") == strlen(line))
+				continue;
+
+			fprintf(stderr, "Error: Invalid key event on line %d of \'%s\'!\n", lineNum, fileName);
+			exit(FILE_ERROR);
+		}
+
+		if(time < 0 || key < 0 || key > 32767 || (keyEventCount && time < keyEvents[keyEventCount - 1].time)) {
+			fprintf(stderr, "Error: Invalid key event on line %d of \'%s\'!\n", lineNum, fileName);
+			exit(FILE_ERROR);
+		}
+
+		if(keyEventCount == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+
+			if(!(keyEvents = realloc(keyEvents, capacity * sizeof(keyEvent)))) {
+				fprintf(stderr, "Error: Could not allocate memory for key trace!\n");
+				exit(MEM_ERROR);
+			}
+		}
+
+		keyEvents[keyEventCount].time = time;
+		keyEvents[keyEventCount++].key = key;
+	}
+
+	fclose(traceFile);
+
+	return;
+}
+
+void parseScreenDumps(const char * list)
+{
+	const char * position = list;
+
+	while(*position) {
+		char * end;
+		long time;
+
+		if(!strncmp(position, "end", 3)) {
+			dumpAtEnd = true;
+			end = (char *)position + 3;
+		} else if((time = strtol(position, &end, 10)) < 0 || end == position) {
+			fprintf(stderr, "Error: Invalid screen dump time in \"%s\"!\n", list);
+			exit(FILE_ERROR);
+		} else {
+			if(!(dumpTimes = realloc(dumpTimes, (dumpCount + 1) * sizeof(long)))) {
+				fprintf(stderr, "Error: Could not allocate memory for screen dumps!\n");
+				exit(MEM_ERROR);
+			}
+
+			dumpTimes[dumpCount++] = time;
+		}
+
+		if(*end && *end != ',') {
+			fprintf(stderr, "Error: Invalid screen dump time in \"%s\"!\n", list);
+			exit(FILE_ERROR);
+		}
+
+		position = *end ? end + 1 : end;
+	}
+
+	if(dumpCount) /* Only "end" was given */
+		qsort(dumpTimes, dumpCount, sizeof(long), compareTimes);
+
+	return;
+}
+
+long nextDeviceEvent()
+{
+	long next = LONG_MAX;
+
+	if(nextKeyEvent < keyEventCount)
+		next = keyEvents[nextKeyEvent].time;
+
+	if(nextDump < dumpCount && dumpTimes[nextDump] < next)
+		next = dumpTimes[nextDump];
+
+	return next;
+}
+
+void processDeviceEvents(int16_t * memory, long time)
+{
+	char fileName[64];
+
+	for(; nextKeyEvent < keyEventCount && keyEvents[nextKeyEvent].time <= time; nextKeyEvent++)
+		memory[DEVICE_KEYBOARD] = keyEvents[nextKeyEvent].key;
+
+	/* Dumps are named after the time they were asked for, which is also when they are taken */
+
+	for(; nextDump < dumpCount && dumpTimes[nextDump] <= time; nextDump++) {
+		snprintf(fileName, sizeof(fileName), "screen-%ld.pbm", dumpTimes[nextDump]);
+		writeScreen(memory, fileName);
+	}
+
+	return;
+}
+
+void finishDevices(int16_t * memory, long time)
+{
+	char fileName[64];
+
+	if(dumpAtEnd) {
+		snprintf(fileName, sizeof(fileName), "screen-%ld.pbm", time);
+		writeScreen(memory, fileName);
+	}
+
+	return;
+}
+
+void resetDevices()
+{
+	nextKeyEvent = nextDump = 0;
+
+	return;
+}
+
+void writeScreen(const int16_t * memory, const char * fileName)
+{
+	FILE * screenFile;
+	unsigned char row[SCREEN_WIDTH / 8];
+
+	if(!(screenFile = fopen(fileName, "wb"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	fprintf(screenFile, "P4\n%d %d\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+
+	/* The leftmost pixel of a screen word is its lowest bit, PBM wants it in the highest bit of a byte */
+
+	for(int y = 0; y < SCREEN_HEIGHT; y++) {
+		for(int x = 0; x < SCREEN_ROW_WORDS; x++) {
+			uint16_t word = (uint16_t)memory[DEVICE_SCREEN + y * SCREEN_ROW_WORDS + x];
+
+			row[2 * x] = row[2 * x + 1] = 0;
+
+			for(int bit = 0; bit < 16; bit++)
+				if(word & 1 << bit)
+					row[2 * x + bit / 8] |= 0x80 >> (bit % 8);
+		}
+
+		fwrite(row, 1, sizeof(row), screenFile);
+	}
+
+	fclose(screenFile);
+
+	return;
+}
+
+void freeDevices()
+{
+	free(keyEvents);
+	free(dumpTimes);
+
+	keyEvents = NULL;
+	dumpTimes = NULL;
+	keyEventCount = dumpCount = 0;
+	resetDevices();
+
+	return;
+}
\ No newline at end of file
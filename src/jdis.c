@@ -0,0 +1,55 @@
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/jack.h"
+#include "../include/jvmb.h"
+
+static const struct option longOptions[] = {
+	{ "help", no_argument, NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void printUsage(FILE * stream, const char * programName)
+{
+	fprintf(stream, "Usage: ./%s [options] [.vmb files]\n\n", programName);
+	fprintf(stream, "Writes the VM commands of every bytecode file to stdout\n\n");
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  -h, --help\t\tDisplay this message\n");
+}
+
+int main(int argc, char * argv[])
+{
+	int option;
+
+	while((option = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+		switch(option) {
+			case 'h':
+				printUsage(stdout, argv[0]);
+				exit(EXEC_SUCCESS);
+			default:
+				printUsage(stderr, argv[0]);
+				exit(FILE_ERROR);
+		}
+	}
+
+	if(optind == argc) {
+		fprintf(stderr, "Error: No input files given!\n\n");
+		printUsage(stderr, argv[0]);
+		return FILE_ERROR;
+	}
+
+	for(int i = optind; i < argc; i++) {
+		size_t size;
+		const vmbHeader * header = mapBytecode(argv[i], &size);
+		const vmbInstruction * instructions = (const vmbInstruction *)(header + 1);
+		const char * strings = (const char *)(instructions + header->instructionCount);
+
+		for(uint32_t j = 0; j < header->instructionCount; j++)
+			decodeInstruction(stdout, &instructions[j], strings);
+
+		unmapBytecode(header, size);
+	}
+
+	return EXEC_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,654 @@
+#include <ctype.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/jack.h"
+#include "../include/jdev.h"
+#include "../include/jemu.h"
+
+uint16_t rom[HACK_ROM_SIZE];
+int romSize = 0;
+
+hackInstruction program[HACK_ROM_SIZE + 1]; /* The slot behind the last ROM address stops programs running off its end */
+
+int16_t ram[HACK_RAM_SIZE];
+int16_t registerA = 0;
+int16_t registerD = 0;
+int programCounter = 0;
+long cycles = 0;
+
+int watchAddress = -1;
+bool watchValueSet = false;
+int16_t watchValue = 0;
+
+hackSymbol * labelSymbols = NULL; /* Sorted by name once the first pass is done */
+int labelSymbolCount = 0;
+int labelSymbolCapacity = 0;
+hackSymbol * variableSymbols = NULL;
+int variableSymbolCount = 0;
+int variableSymbolCapacity = 0;
+
+static const hackSymbol predefinedSymbols[] = {
+	{ "SP", 0 }, { "LCL", 1 }, { "ARG", 2 }, { "THIS", 3 }, { "THAT", 4 },
+	{ "R0", 0 }, { "R1", 1 }, { "R2", 2 }, { "R3", 3 }, { "R4", 4 }, { "R5", 5 }, { "R6", 6 }, { "R7", 7 },
+	{ "R8", 8 }, { "R9", 9 }, { "R10", 10 }, { "R11", 11 }, { "R12", 12 }, { "R13", 13 }, { "R14", 14 }, { "R15", 15 },
+	{ "SCREEN", 16384 }, { "KBD", 24576 }
+};
+
+static const hackComputation computations[] = {
+	{ "0", 0x2A, hackZero }, { "1", 0x3F, hackOne }, { "-1", 0x3A, hackMinusOne },
+	{ "D", 0x0C, hackD }, { "A", 0x30, hackA }, { "M", 0x70, hackM },
+	{ "!D", 0x0D, hackNotD }, { "!A", 0x31, hackNotA }, { "!M", 0x71, hackNotM },
+	{ "-D", 0x0F, hackNegD }, { "-A", 0x33, hackNegA }, { "-M", 0x73, hackNegM },
+	{ "D+1", 0x1F, hackDPlusOne }, { "A+1", 0x37, hackAPlusOne }, { "M+1", 0x77, hackMPlusOne },
+	{ "D-1", 0x0E, hackDMinusOne }, { "A-1", 0x32, hackAMinusOne }, { "M-1", 0x72, hackMMinusOne },
+	{ "D+A", 0x02, hackDPlusA }, { "D+M", 0x42, hackDPlusM }, { "D-A", 0x13, hackDMinusA }, { "D-M", 0x53, hackDMinusM },
+	{ "A-D", 0x07, hackAMinusD }, { "M-D", 0x47, hackMMinusD }, { "D&A", 0x00, hackDAndA }, { "D&M", 0x40, hackDAndM },
+	{ "D|A", 0x15, hackDOrA }, { "D|M", 0x55, hackDOrM }
+};
+
+static const char * jumpMnemonics[] = { "", "JGT", "JEQ", "JGE", "JLT", "JNE", "JLE", "JMP" };
+
+static const struct option longOptions[] = {
+	{ "bench", required_argument, NULL, 'b' },
+	{ "cycles", required_argument, NULL, 'c' },
+	{ "keys", required_argument, NULL, 'k' },
+	{ "ram", required_argument, NULL, 'r' },
+	{ "screen", required_argument, NULL, 'd' },
+	{ "watch", required_argument, NULL, 'w' },
+	{ "help", no_argument, NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void printUsage(FILE * stream, const char * programName)
+{
+	fprintf(stream, "Usage: ./%s [options] [.hack or .asm file]\n\n", programName);
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  --bench=N\t\tRun the program N times and report the emulation speed\n");
+	fprintf(stream, "  --cycles=N\t\tStop after N cycles\n");
+	fprintf(stream, "  --keys=FILE\t\tReplay the key events of FILE, lines of \"CYCLE KEY\", on the keyboard register\n");
+	fprintf(stream, "  --ram=ADDR[:COUNT]\tPrint COUNT words of RAM from ADDR after the run\n");
+	fprintf(stream, "  --screen=N[,N...]\tWrite the screen to screen-N.pbm after N cycles, \"end\" when the program stops\n");
+	fprintf(stream, "  --watch=ADDR[=VALUE]\tStop when RAM[ADDR] is written, or written with VALUE\n");
+	fprintf(stream, "  -h, --help\t\tDisplay this message\n");
+}
+
+static int compareSymbols(const void * first, const void * second)
+{
+	return strcmp(((const hackSymbol *)first)->name, ((const hackSymbol *)second)->name);
+}
+
+/* Functions for loading Hack programs */
+
+void loadHackFile(const char * fileName)
+{
+	FILE * hackFile;
+	char line[MAX_ASM_LINE_SIZE];
+	int lineNum = 0;
+
+	if(!(hackFile = fopen(fileName, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	while(fgets(line, sizeof(line), hackFile)) {
+		uint16_t word = 0;
+		int digits = 0;
+
+		lineNum++;
+
+		for(char * character = line; *character && *character != '\n' && *character != '\r'; character++, digits++) {
+			if((*character != '0' && *character != '1') || digits == 16) {
+				fprintf(stderr, "Error: Invalid instruction on line %d of \'%s\'!\n", lineNum, fileName);
+				exit(FILE_ERROR);
+			}
+
+			word = (uint16_t)(word << 1 | (*character - '0'));
+		}
+
+		if(!digits)
+			continue;
+
+		if(digits != 16 || romSize == HACK_ROM_SIZE) {
+			fprintf(stderr, "Error: Invalid instruction on line %d of \'%s\'!\n", lineNum, fileName);
+			exit(FILE_ERROR);
+		}
+
+		rom[romSize++] = word;
+	}
+
+	fclose(hackFile);
+
+	return;
+}
+
+static void stripLine(char * line)
+{
+	char * target = line;
+
+	if(strstr(line, "//"))
+		*strstr(line, "//") = '\0';
+
+	for(char * character = line; *character; character++)
+		if(!isspace((unsigned char)*character))
+			*target++ = *character;
+
+	*target = '\0';
+
+	return;
+}
+
+void loadAssemblyFile(const char * fileName)
+{
+	FILE * asmFile;
+	char line[MAX_ASM_LINE_SIZE];
+	int lineNum = 0;
+	int address = 0;
+
+	if(!(asmFile = fopen(fileName, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	/* The first pass only binds labels to the address of the instruction following them */
+
+	while(fgets(line, sizeof(line), asmFile)) {
+		stripLine(line);
+
+		if(*line == '(') {
+			char * end = strchr(line, ')');
+
+			if(!end || end[1] || end == line + 1) {
+				fprintf(stderr, "Error: Invalid label \"%s\" in \'%s\'!\n", line, fileName);
+				exit(FILE_ERROR);
+			}
+
+			*end = '\0';
+			addHackSymbol(&labelSymbols, &labelSymbolCount, &labelSymbolCapacity, line + 1, address);
+		} else if(*line) {
+			address++;
+		}
+	}
+
+	if(labelSymbolCount) /* A program without any labels has no table at all */
+		qsort(labelSymbols, labelSymbolCount, sizeof(hackSymbol), compareSymbols);
+
+	for(int i = 1; i < labelSymbolCount; i++) {
+		if(!strcmp(labelSymbols[i - 1].name, labelSymbols[i].name)) {
+			fprintf(stderr, "Error: Label \"%s\" is defined more than once!\n", labelSymbols[i].name);
+			exit(FILE_ERROR);
+		}
+	}
+
+	if(address > HACK_ROM_SIZE) {
+		fprintf(stderr, "Error: \'%s\' does not fit into the %d words of ROM!\n", fileName, HACK_ROM_SIZE);
+		exit(FILE_ERROR);
+	}
+
+	rewind(asmFile);
+
+	while(fgets(line, sizeof(line), asmFile)) {
+		lineNum++;
+		stripLine(line);
+
+		if(*line && *line != '(')
+			rom[romSize++] = (uint16_t)assembleInstruction(line, lineNum, fileName);
+	}
+
+	fclose(asmFile);
+
+	return;
+}
+
+int assembleInstruction(char * line, int lineNum, const char * fileName)
+{
+	char * computation = line;
+	char * jump;
+	int destination = 0;
+	int jumpBits = 0;
+
+	if(*line == '@') {
+		int value;
+
+		if(isdigit((unsigned char)line[1])) {
+			char * end;
+			long constant = strtol(line + 1, &end, 10);
+
+			if(*end || constant > 32767) {
+				fprintf(stderr, "Error: Invalid constant \"%s\" on line %d of \'%s\'!\n", line + 1, lineNum, fileName);
+				exit(FILE_ERROR);
+			}
+
+			return (int)constant;
+		}
+
+		/* Symbols that are neither labels nor predefined are variables, allocated in order of appearance */
+
+		if((value = lookupHackSymbol(line + 1)) < 0) {
+			value = HACK_VARIABLE_BASE + variableSymbolCount;
+			addHackSymbol(&variableSymbols, &variableSymbolCount, &variableSymbolCapacity, line + 1, value);
+		}
+
+		return value;
+	}
+
+	if(strchr(line, '=')) {
+		for(; *computation != '='; computation++) {
+			int bit = *computation == 'A' ? DEST_A : *computation == 'D' ? DEST_D : *computation == 'M' ? DEST_M : 0;
+
+			if(!bit || destination & bit) {
+				fprintf(stderr, "Error: Invalid destination \"%s\" on line %d of \'%s\'!\n", line, lineNum, fileName);
+				exit(FILE_ERROR);
+			}
+
+			destination |= bit;
+		}
+
+		computation++;
+	}
+
+	if((jump = strchr(computation, ';'))) {
+		*jump++ = '\0';
+
+		for(jumpBits = 1; jumpBits < 8 && strcmp(jumpMnemonics[jumpBits], jump); jumpBits++)
+			;
+
+		if(jumpBits == 8) {
+			fprintf(stderr, "Error: Invalid jump \"%s\" on line %d of \'%s\'!\n", jump, lineNum, fileName);
+			exit(FILE_ERROR);
+		}
+	}
+
+	for(unsigned int i = 0; i < sizeof(computations) / sizeof(hackComputation); i++)
+		if(!strcmp(computations[i].mnemonic, computation))
+			return 0xE000 | computations[i].bits << 6 | destination << 3 | jumpBits;
+
+	fprintf(stderr, "Error: Invalid computation \"%s\" on line %d of \'%s\'!\n", computation, lineNum, fileName);
+	exit(FILE_ERROR);
+}
+
+void addHackSymbol(hackSymbol ** symbols, int * symbolCount, int * symbolCapacity, const char * name, int value)
+{
+	if(*symbolCount == *symbolCapacity) {
+		*symbolCapacity = *symbolCapacity ? *symbolCapacity * 2 : 256;
+
+		if(!(*symbols = realloc(*symbols, *symbolCapacity * sizeof(hackSymbol)))) {
+			fprintf(stderr, "Error: Could not allocate memory for symbol table!\n");
+			exit(MEM_ERROR);
+		}
+	}
+
+	if(!((*symbols)[*symbolCount].name = calloc(strlen(name) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for symbol table!\n");
+		exit(MEM_ERROR);
+	}
+
+	strcpy((*symbols)[*symbolCount].name, name);
+	(*symbols)[(*symbolCount)++].value = value;
+
+	return;
+}
+
+int lookupHackSymbol(const char * name)
+{
+	hackSymbol key = { (char *)name, 0 };
+	hackSymbol * found;
+
+	if(labelSymbolCount && (found = bsearch(&key, labelSymbols, labelSymbolCount, sizeof(hackSymbol), compareSymbols)))
+		return found->value;
+
+	for(unsigned int i = 0; i < sizeof(predefinedSymbols) / sizeof(hackSymbol); i++)
+		if(!strcmp(predefinedSymbols[i].name, name))
+			return predefinedSymbols[i].value;
+
+	for(int i = 0; i < variableSymbolCount; i++)
+		if(!strcmp(variableSymbols[i].name, name))
+			return variableSymbols[i].value;
+
+	return -1;
+}
+
+void decodeProgram()
+{
+	hackOperation operationOf[128];
+
+	for(int i = 0; i < 128; i++)
+		operationOf[i] = hackOperationCount;
+
+	for(unsigned int i = 0; i < sizeof(computations) / sizeof(hackComputation); i++)
+		operationOf[computations[i].bits] = computations[i].operation;
+
+	for(int i = 0; i <= HACK_ROM_SIZE; i++) {
+		memset(&program[i], 0, sizeof(hackInstruction));
+		program[i].operation = hackEnd;
+	}
+
+	for(int i = 0; i < romSize; i++) {
+		if(!(rom[i] & 0x8000)) {
+			program[i].operation = hackLoad;
+			program[i].value = (int16_t)rom[i];
+			continue;
+		}
+
+		if((program[i].operation = operationOf[rom[i] >> 6 & 0x7F]) == hackOperationCount) {
+			fprintf(stderr, "Error: Invalid instruction at ROM[%d]!\n", i);
+			exit(FILE_ERROR);
+		}
+
+		program[i].destination = rom[i] >> 3 & 7;
+		program[i].jump = rom[i] & 7;
+	}
+
+	/* An unconditional jump without side effects back to the load of its own target is the usual way to halt */
+
+	for(int i = 1; i < romSize; i++)
+		if(program[i].operation != hackLoad && !program[i].destination && program[i].jump == 7 && program[i - 1].operation == hackLoad && (program[i - 1].value == i - 1 || program[i - 1].value == i))
+			program[i].operation = hackHalt;
+
+	return;
+}
+
+/* Functions for running Hack programs */
+
+void resetMachine()
+{
+	memset(ram, 0, sizeof(ram));
+	registerA = registerD = 0;
+	programCounter = 0;
+	cycles = 0;
+
+	return;
+}
+
+#define FETCH() \
+	if(count >= maxCycles) { \
+		reason = stopCycles; \
+		goto finished; \
+	} \
+	current = &program[pc]; \
+	count++;
+
+#ifdef HACK_COMPUTED_GOTO
+#define DISPATCH() __extension__ ({ goto * handlers[current->operation]; });
+#define OPERATION(name) name##Handler:
+#define HANDLER(name) __extension__ && name##Handler
+#define NEXT() do { FETCH(); DISPATCH(); } while(0)
+#define END_DISPATCH()
+#else
+#define DISPATCH() switch(current->operation) {
+#define OPERATION(name) case name:
+#define NEXT() continue
+#define END_DISPATCH() }
+#endif
+
+#define MEMORY ram[a & HACK_ADDRESS_MASK]
+
+hackStop runMachine(long maxCycles)
+{
+	const hackInstruction * current;
+	int16_t a = registerA;
+	int16_t d = registerD;
+	int16_t result;
+	int pc = programCounter;
+	long count = cycles;
+	hackStop reason;
+
+#ifdef HACK_COMPUTED_GOTO
+	static const void * const handlers[hackOperationCount] = {
+		HANDLER(hackLoad), HANDLER(hackHalt), HANDLER(hackEnd),
+		HANDLER(hackZero), HANDLER(hackOne), HANDLER(hackMinusOne), HANDLER(hackD), HANDLER(hackA), HANDLER(hackM),
+		HANDLER(hackNotD), HANDLER(hackNotA), HANDLER(hackNotM), HANDLER(hackNegD), HANDLER(hackNegA), HANDLER(hackNegM),
+		HANDLER(hackDPlusOne), HANDLER(hackAPlusOne), HANDLER(hackMPlusOne), HANDLER(hackDMinusOne), HANDLER(hackAMinusOne), HANDLER(hackMMinusOne),
+		HANDLER(hackDPlusA), HANDLER(hackDPlusM), HANDLER(hackDMinusA), HANDLER(hackDMinusM), HANDLER(hackAMinusD), HANDLER(hackMMinusD),
+		HANDLER(hackDAndA), HANDLER(hackDAndM), HANDLER(hackDOrA), HANDLER(hackDOrM)
+	};
+#endif
+
+	if(maxCycles <= 0)
+		maxCycles = LONG_MAX;
+
+	for(;;) {
+		FETCH();
+		DISPATCH();
+
+		OPERATION(hackLoad)
+			a = current->value;
+			pc++;
+			NEXT();
+		OPERATION(hackHalt)
+			count--; /* The halt loop itself is not part of the run */
+			reason = stopHalt;
+			goto finished;
+		OPERATION(hackEnd)
+			count--;
+			reason = stopEnd;
+			goto finished;
+		OPERATION(hackZero) result = 0; goto store;
+		OPERATION(hackOne) result = 1; goto store;
+		OPERATION(hackMinusOne) result = -1; goto store;
+		OPERATION(hackD) result = d; goto store;
+		OPERATION(hackA) result = a; goto store;
+		OPERATION(hackM) result = MEMORY; goto store;
+		OPERATION(hackNotD) result = ~d; goto store;
+		OPERATION(hackNotA) result = ~a; goto store;
+		OPERATION(hackNotM) result = ~MEMORY; goto store;
+		OPERATION(hackNegD) result = (int16_t)-d; goto store;
+		OPERATION(hackNegA) result = (int16_t)-a; goto store;
+		OPERATION(hackNegM) result = (int16_t)-MEMORY; goto store;
+		OPERATION(hackDPlusOne) result = (int16_t)(d + 1); goto store;
+		OPERATION(hackAPlusOne) result = (int16_t)(a + 1); goto store;
+		OPERATION(hackMPlusOne) result = (int16_t)(MEMORY + 1); goto store;
+		OPERATION(hackDMinusOne) result = (int16_t)(d - 1); goto store;
+		OPERATION(hackAMinusOne) result = (int16_t)(a - 1); goto store;
+		OPERATION(hackMMinusOne) result = (int16_t)(MEMORY - 1); goto store;
+		OPERATION(hackDPlusA) result = (int16_t)(d + a); goto store;
+		OPERATION(hackDPlusM) result = (int16_t)(d + MEMORY); goto store;
+		OPERATION(hackDMinusA) result = (int16_t)(d - a); goto store;
+		OPERATION(hackDMinusM) result = (int16_t)(d - MEMORY); goto store;
+		OPERATION(hackAMinusD) result = (int16_t)(a - d); goto store;
+		OPERATION(hackMMinusD) result = (int16_t)(MEMORY - d); goto store;
+		OPERATION(hackDAndA) result = d & a; goto store;
+		OPERATION(hackDAndM) result = d & MEMORY; goto store;
+		OPERATION(hackDOrA) result = d | a; goto store;
+		OPERATION(hackDOrM) result = d | MEMORY; goto store;
+		END_DISPATCH();
+
+store:
+		/* M is written and the jump taken with the A register the instruction started with */
+
+		if(current->destination & DEST_M)
+			MEMORY = result;
+
+		if(current->jump & (result < 0 ? JUMP_NEGATIVE : result ? JUMP_POSITIVE : JUMP_ZERO))
+			pc = a & HACK_ADDRESS_MASK;
+		else
+			pc++;
+
+		if(current->destination & DEST_M && (a & HACK_ADDRESS_MASK) == watchAddress && (!watchValueSet || result == watchValue)) {
+			reason = stopWatch;
+
+			if(current->destination & DEST_A)
+				a = result;
+
+			if(current->destination & DEST_D)
+				d = result;
+
+			goto finished;
+		}
+
+		if(current->destination & DEST_A)
+			a = result;
+
+		if(current->destination & DEST_D)
+			d = result;
+
+		NEXT();
+	}
+
+finished:
+	registerA = a;
+	registerD = d;
+	programCounter = pc;
+	cycles = count;
+
+	return reason;
+}
+
+hackStop runWithDevices(long maxCycles)
+{
+	hackStop reason;
+
+	/* The machine runs in slices up to the next key event or screen dump, so the inner loop never has to look at them */
+
+	for(;;) {
+		long limit;
+
+		processDeviceEvents(ram, cycles);
+		limit = nextDeviceEvent();
+
+		if(maxCycles > 0 && maxCycles < limit)
+			limit = maxCycles;
+
+		if((reason = runMachine(limit)) != stopCycles || (maxCycles > 0 && cycles >= maxCycles))
+			break;
+	}
+
+	finishDevices(ram, cycles);
+
+	return reason;
+}
+
+void printReport(hackStop reason)
+{
+	switch(reason) {
+		case stopHalt:
+			printf("[+] Halted in the loop at ROM[%d] after %ld cycles\n", programCounter - 1, cycles);
+			break;
+		case stopEnd:
+			printf("[+] Ran past the end of the program at ROM[%d] after %ld cycles\n", programCounter, cycles);
+			break;
+		case stopCycles:
+			printf("[+] Stopped at the cycle limit after %ld cycles\n", cycles);
+			break;
+		case stopWatch:
+			printf("[+] RAM[%d] was written with %d after %ld cycles\n", watchAddress, ram[watchAddress], cycles);
+			break;
+	}
+
+	return;
+}
+
+int main(int argc, char * argv[])
+{
+	int option;
+	long maxCycles = 0;
+	int benchRuns = 0;
+	int dumpAddress = -1;
+	int dumpCount = 1;
+	size_t length;
+	hackStop reason;
+
+	while((option = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+		switch(option) {
+			case 'b':
+				benchRuns = atoi(optarg);
+				break;
+			case 'c':
+				maxCycles = atol(optarg);
+				break;
+			case 'd':
+				parseScreenDumps(optarg);
+				break;
+			case 'k':
+				loadKeyTrace(optarg);
+				break;
+			case 'r':
+				if(sscanf(optarg, "%d:%d", &dumpAddress, &dumpCount) < 1 || dumpAddress < 0 || dumpCount < 1 || dumpAddress + dumpCount > HACK_RAM_SIZE) {
+					fprintf(stderr, "Error: Invalid RAM range \"%s\"!\n", optarg);
+					exit(FILE_ERROR);
+				}
+
+				break;
+			case 'w':
+				watchValueSet = strchr(optarg, '=') != NULL;
+
+				if(sscanf(optarg, "%d=%hd", &watchAddress, &watchValue) < 1 || watchAddress < 0 || watchAddress >= HACK_RAM_SIZE) {
+					fprintf(stderr, "Error: Invalid watchpoint \"%s\"!\n", optarg);
+					exit(FILE_ERROR);
+				}
+
+				break;
+			case 'h':
+				printUsage(stdout, argv[0]);
+				exit(EXEC_SUCCESS);
+			default:
+				printUsage(stderr, argv[0]);
+				exit(FILE_ERROR);
+		}
+	}
+
+	if(optind != argc - 1) {
+		fprintf(stderr, "Error: Expected exactly one input file!\n\n");
+		printUsage(stderr, argv[0]);
+		return FILE_ERROR;
+	}
+
+	length = strlen(argv[optind]);
+
+	if(length > 4 && !strcmp(argv[optind] + length - 4, ".asm"))
+		loadAssemblyFile(argv[optind]);
+	else
+		loadHackFile(argv[optind]);
+
+	decodeProgram();
+
+	if(benchRuns > 0) {
+		double best = 0;
+		double total = 0;
+
+		/* Every run starts from a cleared machine, so all of them execute exactly the same instructions */
+
+		for(int i = 0; i < benchRuns; i++) {
+			struct timespec start;
+			struct timespec end;
+			double elapsed;
+
+			resetMachine();
+			resetDevices();
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			reason = runWithDevices(maxCycles);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+
+			elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+			total += elapsed;
+
+			if(!i || elapsed < best)
+				best = elapsed;
+		}
+
+		printReport(reason);
+		printf("[+] %d runs, best %.3f ms, mean %.3f ms, %.1f million cycles per second\n", benchRuns, best * 1e3, total / benchRuns * 1e3, best > 0 ? cycles / best / 1e6 : 0.0);
+	} else {
+		resetMachine();
+		printReport(runWithDevices(maxCycles));
+	}
+
+	for(int i = 0; dumpAddress >= 0 && i < dumpCount; i++)
+		printf("RAM[%d] = %d\n", dumpAddress + i, ram[dumpAddress + i]);
+
+	for(int i = 0; i < labelSymbolCount; i++)
+		free(labelSymbols[i].name);
+
+	for(int i = 0; i < variableSymbolCount; i++)
+		free(variableSymbols[i].name);
+
+	free(labelSymbols);
+	free(variableSymbols);
+	freeDevices();
+
+	return EXEC_SUCCESS;
+}
\ No newline at end of file
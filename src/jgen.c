@@ -1,10 +1,15 @@
 #include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "../include/jack.h"
+#include "../include/jcost.h"
 #include "../include/jgen.h"
+#include "../include/jlink.h"
+#include "../include/jopt.h"
+#include "../include/jvmb.h"
 #include "../include/jsym.h"
 #include "../include/jparse.h"
 
@@ -13,9 +18,216 @@ extern classSymbolTable * currentClass;
 extern functionSymbolTable * currentFunction;
 extern variableSymbol * currentVariable;
 extern statement * curStatement;
+extern nodePool * currentNodePool;
 
 FILE * curFile = NULL;
+char * curFileName = NULL; /* Set while curFile is the output file itself rather than a temporary file */
 int labelID = 0;
+unsigned long outputsReplaced = 0; /* Files rewritten because their content changed, with options.replaceChanged */
+
+pooledString * stringPool = NULL;
+pooledString * lastPooledString = NULL;
+
+/* State of the call site currently being inlined, references inside the callee body are resolved against these */
+
+classSymbolTable * inlineCallerClass = NULL;
+functionSymbolTable * inlineCaller = NULL;
+functionSymbolTable * inlineCallee = NULL;
+variableSymbol * inlineReceiver = NULL;
+expression ** inlineArguments = NULL;
+
+/* Address last stored in pointer 1, valid until the array or index variable is reassigned or control flow merges */
+
+arrayBase thatBase = { NULL, NULL, 0 };
+
+/* Runs of consecutive VM instructions generated from the same source line, for the source map of the current class */
+
+sourceRun * sourceRuns = NULL;
+int sourceRunCount = 0;
+int sourceRunCapacity = 0;
+int instructionIndex = 0;
+int sourceLine = 0;
+
+vmbBuffer classBytecode = { 0 }; /* Bytecode of the current class when emitting bytecode, written when the class is complete */
+
+char pendingLine[MAX_COMMAND_SIZE]; /* Start of a command whose line has not been completed yet */
+size_t pendingLength = 0;
+
+/* Initialisation flags saved while the body of a rotated loop is generated ahead of its condition, nested loops stack on top */
+
+bool * savedInitialised = NULL;
+size_t savedInitialisedCount = 0;
+size_t savedInitialisedCapacity = 0;
+
+static const intrinsic intrinsics[] = {
+	{ "Memory", "peek", 1, true, expandPeek },
+	{ "Memory", "poke", 2, false, expandPoke },
+	{ "Math", "abs", 1, true, expandAbs },
+	{ "Math", "min", 2, true, expandMin },
+	{ "Math", "max", 2, true, expandMax }
+};
+
+bool hasTailEntry = false; /* Whether the current subroutine has a TAIL_CALL label to jump back to */
+
+void emit(const char * format, ...)
+{
+	char * text;
+	int length;
+	va_list arguments;
+
+	va_start(arguments, format);
+	length = vsnprintf(NULL, 0, format, arguments);
+	va_end(arguments);
+
+	if(!(text = malloc(length + 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for generated code!\n");
+		exit(MEM_ERROR);
+	}
+
+	va_start(arguments, format);
+	vsnprintf(text, length + 1, format, arguments);
+	va_end(arguments);
+
+	if(!options.emitBytecode && curFile)
+		fputs(text, curFile);
+
+	if(options.costReportFile || options.sourceMap || options.emitBytecode)
+		processEmittedText(text);
+
+	free(text);
+
+	return;
+}
+
+void processEmittedText(const char * text)
+{
+	const char * end;
+
+	/* Commands may be emitted in pieces, so text is only looked at once a whole line has been collected */
+
+	for(; *text; text = end + 1) {
+		size_t length;
+
+		if(!(end = strchr(text, '\n')))
+			end = text + strlen(text) - 1;
+
+		length = end - text + 1;
+
+		if(pendingLength + length + 1 > MAX_COMMAND_SIZE) {
+			fprintf(stderr, "Error: Generated command too long!\n");
+			exit(MEM_ERROR);
+		}
+
+		memcpy(pendingLine + pendingLength, text, length);
+		pendingLength += length;
+		pendingLine[pendingLength] = '\0';
+
+		if(*end != '\n')
+			break;
+
+		pendingLine[pendingLength - 1] = '\0';
+
+		if(options.costReportFile)
+			recordCommand(pendingLine);
+
+		if(options.sourceMap)
+			recordSourceLine(pendingLine);
+
+		if(options.emitBytecode)
+			encodeCommand(&classBytecode, pendingLine);
+
+		pendingLength = 0;
+	}
+
+	return;
+}
+
+static const char * segmentName(variableSymbol * curVariable)
+{
+	if(curVariable->type == statik)
+		return "static";
+	else if(curVariable->type == field)
+		return "this";
+	else if(curVariable->isArgument)
+		return "argument";
+	else
+		return "local";
+}
+
+static char * processInlinedReference(term * curTerm)
+{
+	variableSymbol * curVariable;
+	classSymbolTable * calleeClass = currentClass;
+	functionSymbolTable * callee = currentFunction;
+
+	if((curVariable = lookupFunctionVariable(callee, curTerm->variableName))) {
+		/* Parameters are replaced by the argument expression of the call site, which has to be generated in the scope of the caller */
+
+		currentClass = inlineCallerClass;
+		currentFunction = inlineCaller;
+		inlineCallee = NULL;
+
+		processExpression(inlineArguments[curVariable->offset - (callee->type == method)]);
+
+		currentClass = calleeClass;
+		currentFunction = callee;
+		inlineCallee = callee;
+	} else {
+		curVariable = lookupClassVariable(calleeClass, curTerm->variableName);
+
+		if(curVariable->type == field && inlineReceiver) { /* Fields of another object are reached through the "that" segment */
+			emit("push %s %d\npop pointer 1\npush that %d\n", segmentName(inlineReceiver), inlineReceiver->offset, curVariable->offset);
+			invalidateArrayBase();
+		} else {
+			emit("push %s %d\n", segmentName(curVariable), curVariable->offset);
+		}
+	}
+
+	return curVariable->typeName;
+}
+
+static bool inlineFunctionCall(functionCall * call, classSymbolTable * calleeClass, functionSymbolTable * callee, variableSymbol * receiver)
+{
+	expression * body;
+	variableSymbol * curArgument = callee->arguments;
+	unsigned int parameterCount = callee->argumentCount - (callee->type == method);
+
+	if(!options.inlineThreshold || call->expressionCount != parameterCount || !isInlineCandidate(calleeClass, callee, calleeClass == currentClass))
+		return false;
+
+	body = callee->statements->returnExpression;
+
+	/* Arguments are substituted into the body in place of the parameters, so they must be free of side effects and must not be evaluated more often than at the call site */
+
+	for(unsigned int i = 0; i < call->expressionCount; i++, curArgument = curArgument->nextVariable) {
+		unsigned int uses = countVariableUses(body, curArgument->name);
+
+		if(expressionHasCalls(call->expressionList[i]))
+			return false;
+
+		if((uses > 1 || !uses) && !isSimpleExpression(call->expressionList[i]))
+			return false;
+	}
+
+	inlineCallerClass = currentClass;
+	inlineCaller = currentFunction;
+	inlineCallee = callee;
+	inlineReceiver = receiver;
+	inlineArguments = call->expressionList;
+
+	currentClass = calleeClass;
+	currentFunction = callee;
+
+	processExpression(body);
+
+	currentClass = inlineCallerClass;
+	currentFunction = inlineCaller;
+	inlineCallee = NULL;
+
+	recordInlinedCall(currentClass, currentFunction, calleeClass, callee, curStatement ? curStatement->lineNum : callee->lineNum);
+
+	return true;
+}
 
 void generateCode()
 {
@@ -29,9 +241,27 @@ void generateCode()
 	return;
 }
 
-void processClass(classSymbolTable * curClass)
+static char * outputFileName(classSymbolTable * curClass)
 {
 	char * filename;
+	size_t length = strlen(curClass->name) + (curClass->outputDirectory ? strlen(curClass->outputDirectory) + 1 : 0);
+
+	if(!(filename = calloc(length + 9, 1))) { /* Room for the ".vmb" extension and the ".map" suffix of the source map */
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	if(curClass->outputDirectory)
+		snprintf(filename, length + 5, "%s/%s.vm%s", curClass->outputDirectory, curClass->name, options.emitBytecode ? "b" : "");
+	else
+		snprintf(filename, length + 5, "%s.vm%s", curClass->name, options.emitBytecode ? "b" : "");
+
+	return filename;
+}
+
+void processClass(classSymbolTable * curClass)
+{
+	char * filename = NULL; /* Only built once it is needed, generation may end at any point when errors are recovered from */
 
 	currentClass = curClass;
 	labelID = 0;
@@ -39,40 +269,123 @@ void processClass(classSymbolTable * curClass)
 	if(!isupper(curClass->name[0]))
 		semanticWarning("Class name should start with capital letter");
 
-	if(!(filename = calloc(strlen(curClass->name) + 4, 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
-		exit(MEM_ERROR);
-	}
-
-	snprintf(filename, strlen(curClass->name) + 4, "%s.vm", curClass->name);
-
-	if(!(curFile = fopen(filename, "w"))) {
+	if(options.checkOnly) { /* Only the diagnostics of the generation are wanted */
+		curFile = NULL;
+	} else if(options.linkFile || options.replaceChanged) { /* Linked classes are only collected here, replaced ones are compared with the old file first */
+		if(!(curFile = tmpfile())) {
+			fprintf(stderr, "Error: Could not create temporary file for class \"%s\"!\n", curClass->name);
+			exit(FILE_ERROR);
+		}
+	} else if(!(curFile = fopen(filename = outputFileName(curClass), options.emitBytecode ? "wb" : "w"))) {
 		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", curClass->name);
 		exit(FILE_ERROR);
 	}
 
+	curFileName = filename;
+
+	instructionIndex = 0;
+	sourceLine = curClass->lineNum;
+
 	for(functionSymbolTable * curFunction = curClass->functions; curFunction; curFunction = curFunction->nextFunction)
 		processFunction(curFunction);
 
+	sourceLine = curClass->lineNum;
+	processStringPool();
+	freeStringPool();
+
+	if(curFile) { /* Closed early when an error made the output of the class useless */
+		if(options.linkFile)
+			collectLinkedClass(curClass->name, curFile);
+
+		if(options.emitBytecode)
+			writeBytecode(&classBytecode, curFile);
+
+		if((options.replaceChanged || options.sourceMap) && !filename)
+			filename = outputFileName(curClass);
+
+		if(options.replaceChanged)
+			replaceOutput(curFile, filename);
+
+		if(options.sourceMap) {
+			strcat(filename, ".map");
+			processSourceMap(filename);
+		}
+	}
+
+	freeBytecode(&classBytecode);
+	freeSourceMap();
+
+	if(curFile)
+		fclose(curFile);
+
+	curFile = NULL;
+	curFileName = NULL;
 	free(filename);
-	fclose(curFile);
 
 	return;
 }
 
+static bool hasSizedAlloc(int size)
+{
+	classSymbolTable * memoryClass;
+	functionSymbolTable * allocation;
+	char name[32];
+
+	/* The entry for the size is only called when the Memory class of the program defines it, otherwise objects are allocated as usual */
+
+	if(!options.sizedAlloc || size < 1 || !(memoryClass = lookupClass("Memory")))
+		return false;
+
+	snprintf(name, sizeof(name), "alloc%d", size);
+
+	return (allocation = lookupClassFunction(memoryClass, name)) && allocation->type == func && !allocation->argumentCount;
+}
+
 void processFunction(functionSymbolTable * curFunction)
 {
+	int localCount;
+
 	currentFunction = curFunction;
+	currentNodePool = curFunction->nodes; /* Temporaries created by the optimisations belong to the function as well */
+	savedInitialisedCount = 0; /* Anything left over from a loop abandoned because of an error */
 
 	if(!islower(currentFunction->name[0]))
 		semanticWarning("Function name should start with lowercase letter");
 
-	fprintf(curFile, "function %s.%s %d\n", currentClass->name, curFunction->name, curFunction->variableCount);
+	if(options.hoistInvariants)
+		hoistLoopInvariants(currentClass, curFunction);
+
+	hasTailEntry = options.eliminateTailCalls && hasSelfTailCall(curFunction->statements, currentClass, curFunction);
 
-	if(curFunction->type == constructor)
-		fprintf(curFile, "push constant %d\ncall Memory.alloc 1\npop pointer 0\n", currentClass->fieldCount); /* TODO: Push the scope instead of the argument count */
+	if(options.packLocals) {
+		localCount = packLocalVariables(curFunction);
+	} else {
+		localCount = curFunction->variableCount;
+
+		if(hasTailEntry) { /* Only needed to find the locals which have to be cleared again before jumping back */
+			analyseLiveness(curFunction);
+			freeLiveness();
+		}
+	}
+
+	invalidateArrayBase();
+
+	emit("function %s.%s %d\n", currentClass->name, curFunction->name, localCount);
+
+	sourceLine = curFunction->lineNum;
+
+	if(options.annotateLines)
+		emit("// line %d\n", curFunction->lineNum);
+
+	if(curFunction->type == constructor && hasSizedAlloc(currentClass->fieldCount))
+		emit("call Memory.alloc%d 0\npop pointer 0\n", currentClass->fieldCount);
+	else if(curFunction->type == constructor)
+		emit("push constant %d\ncall Memory.alloc 1\npop pointer 0\n", currentClass->fieldCount); /* TODO: Push the scope instead of the argument count */
 	else if(curFunction->type == method)
-		fprintf(curFile, "push argument 0\npop pointer 0\n");
+		emit("push argument 0\npop pointer 0\n");
+
+	if(hasTailEntry)
+		emit("label TAIL_CALL\n");
 
 	if(!processStatements(curFunction->statements) && strcmp(curFunction->typeName, "void"))
 		semanticWarning("Non-void function not guaranteed to return a value");
@@ -82,42 +395,60 @@ void processFunction(functionSymbolTable * curFunction)
 
 bool processStatements(statement * currentStatement)
 {
+	jmp_buf recovery;
+	jmp_buf * previousRecovery = errorRecovery;
+	volatile bool returns = false;
+
 	if(!currentStatement)
 		return false;
 
 	curStatement = currentStatement;
+	sourceLine = currentStatement->lineNum;
 
-	switch(currentStatement->type) {
-		case ifStatement:
-			if(processIfStatement(currentStatement)) {
-				if(currentStatement->nextStatement) {
-					semanticWarning("Unreachable code detected");
-				}
+	if(options.annotateLines)
+		emit("// line %d\n", currentStatement->lineNum);
 
-				return true;
-			}
+	/* A statement with a semantic error is abandoned and checking carries on with the next one */
 
-			break;
-		case letStatement:
-			processLetStatement(currentStatement);
-			break;
-		case whileStatement:
-			processWhileStatement(currentStatement);
-			break; 
-		case returnStatement:
-			processReturnStatement(currentStatement);
-			
-			if(currentStatement->nextStatement)
-				semanticWarning("Unreachable code detected");
+	if(!diagnosticHook)
+		errorRecovery = &recovery;
 
-			return true;
-		case doStatement:
-			processDoStatement(currentStatement);
-			break;
-		default:
-			break;
+	if(setjmp(recovery)) {
+		abandonStatement();
+	} else {
+		switch(currentStatement->type) {
+			case ifStatement:
+				if((returns = processIfStatement(currentStatement)) && currentStatement->nextStatement)
+					semanticWarning("Unreachable code detected");
+
+				break;
+			case letStatement:
+				processLetStatement(currentStatement);
+				break;
+			case whileStatement:
+				processWhileStatement(currentStatement);
+				break; 
+			case returnStatement:
+				processReturnStatement(currentStatement);
+				returns = true;
+
+				if(currentStatement->nextStatement)
+					semanticWarning("Unreachable code detected");
+
+				break;
+			case doStatement:
+				processDoStatement(currentStatement);
+				break;
+			default:
+				break;
+		}
 	}
 
+	errorRecovery = previousRecovery;
+
+	if(returns)
+		return true;
+
 	return processStatements(currentStatement->nextStatement);
 }
 
@@ -125,17 +456,46 @@ bool processIfStatement(statement * currentStatement)
 {
 	bool retval; /* Keep track of whether or not both the if/else blocks return a value for later semantic analysis */  
 	int currentLabel = labelID++; /* Store an internal copy of the current label ID in case a nested loop or if/else block increments it */
+	char label[LABEL_SIZE];
+	pathCost before;
+	pathCost first;
 
-	processExpression(currentStatement->ifCondition);
-	fprintf(curFile, "if-goto IF_%d\n", currentLabel);
+	if(isNegatedCondition(currentStatement->ifCondition)) {
+		/* A negated condition is inverted at compile time by branching to the else block when its operand holds, or past the if block when there is no else block */
 
-	retval = processStatements(currentStatement->elseStatements);
+		snprintf(label, LABEL_SIZE, currentStatement->elseStatements ? "ELSE_%d" : "ENDIF_%d", currentLabel);
+		processCondition(currentStatement->ifCondition, false, label);
 
-	fprintf(curFile, "goto ENDIF_%d\nlabel IF_%d\n", currentLabel, currentLabel);
+		before = currentPathCost();
+		retval = processStatements(currentStatement->ifStatements);
 
-	retval &= processStatements(currentStatement->ifStatements);
+		if(currentStatement->elseStatements) {
+			emit("goto ENDIF_%d\nlabel ELSE_%d\n", currentLabel, currentLabel);
+			invalidateArrayBase();
+		}
+
+		first = currentPathCost();
+		setPathCost(before);
+		retval &= processStatements(currentStatement->elseStatements);
+	} else {
+		snprintf(label, LABEL_SIZE, "IF_%d", currentLabel);
+		processCondition(currentStatement->ifCondition, true, label);
+
+		before = currentPathCost();
+		retval = processStatements(currentStatement->elseStatements);
+
+		emit("goto ENDIF_%d\nlabel IF_%d\n", currentLabel, currentLabel);
+		invalidateArrayBase();
+
+		first = currentPathCost();
+		setPathCost(before);
+		retval &= processStatements(currentStatement->ifStatements);
+	}
 
-	fprintf(curFile, "label ENDIF_%d\n", currentLabel);
+	mergePathCosts(first, currentPathCost());
+
+	emit("label ENDIF_%d\n", currentLabel);
+	invalidateArrayBase();
 
 	return retval; 
 }
@@ -155,39 +515,58 @@ void processLetStatement(statement * currentStatement)
 	/* Push the variable being initialised to the stack */
 	
 	if(currentStatement->indexExpression) {
-		fprintf(curFile, "push ");
+		int offset;
+
+		if((offset = reuseArrayBase(curVariable, currentStatement->indexExpression)) >= 0) {
+			emit("pop that %d\n", offset);
+			curVariable->initialised = true;
+
+			return;
+		}
+
+		emit("push ");
 
 		if(curVariable->type == statik)
-			fprintf(curFile, "static ");
+			emit("static ");
 		else if(curVariable->type == field)
-			fprintf(curFile, "this ");
+			emit("this ");
 		else if(curVariable->isArgument)
-			fprintf(curFile, "argument ");
+			emit("argument ");
 		else 
-			fprintf(curFile, "local ");
+			emit("local ");
 
-		fprintf(curFile, "%d\n", curVariable->offset);
+		emit("%d\n", curVariable->offset);
 
 		if(strcmp(processExpression(currentStatement->indexExpression), "int"))
 			semanticError("Array expression must be of integer type");
 
-		fprintf(curFile, "add\npop pointer 1\npop that 0\n");
+		emit("add\npop pointer 1\npop that 0\n");
+		recordArrayBase(curVariable, currentStatement->indexExpression);
 	} else {
-		fprintf(curFile, "pop ");
+		emit("pop ");
 
 		if(curVariable->type == statik)
-			fprintf(curFile, "static ");
+			emit("static ");
 		else if(curVariable->type == field)
-			fprintf(curFile, "this ");
+			emit("this ");
 		else if(curVariable->isArgument)
-			fprintf(curFile, "argument ");
+			emit("argument ");
 		else 
-			fprintf(curFile, "local ");
+			emit("local ");
 
-		fprintf(curFile, "%d\n", curVariable->offset);
+		emit("%d\n", curVariable->offset);
 
-		if(strcmp(expressionType, curVariable->typeName))
+		if(curVariable == thatBase.array || curVariable == thatBase.index)
+			invalidateArrayBase();
+
+		if(curVariable->isTemporary) {
+			/* Temporaries take on the type of the value they hold */
+
+			free(curVariable->typeName);
+			setVariableTypeName(curVariable, expressionType);
+		} else if(strcmp(expressionType, curVariable->typeName)) {
 			semanticWarning("Expression type does not match variable type");
+		}
 	}
 
 	curVariable->initialised = true;
@@ -198,87 +577,349 @@ void processLetStatement(statement * currentStatement)
 void processWhileStatement(statement * currentStatement)
 {
 	int currentLabel = labelID++; /* Store an internal copy of the current label ID in case a nested loop or if/else block increments it */
+	char label[LABEL_SIZE];
+	pathCost before;
+	size_t entryState;
+	size_t bodyState;
+
+	/* Cost estimates count a single iteration on the worst path and none on the best path */
+
+	if(isNegatedCondition(currentStatement->whileCondition) || isConstantCondition(currentStatement->whileCondition)) {
+		/* Leaving the loop on the inverted condition needs no "not", and a constant condition needs no test at all */
+
+		snprintf(label, LABEL_SIZE, "END_WHILE_%d", currentLabel);
+
+		emit("label WHILE_%d\n", currentLabel);
+		invalidateArrayBase();
+		processCondition(currentStatement->whileCondition, false, label);
+		before = currentPathCost();
+		processStatements(currentStatement->whileStatements);
+		emit("goto WHILE_%d\nlabel END_WHILE_%d\n", currentLabel, currentLabel);
+		mergePathCosts(before, currentPathCost());
+		invalidateArrayBase();
+	} else {
+		/* Otherwise the test is moved below the body so each iteration takes a single conditional branch */
+
+		snprintf(label, LABEL_SIZE, "WHILE_BODY_%d", currentLabel);
+
+		emit("goto WHILE_%d\nlabel WHILE_BODY_%d\n", currentLabel, currentLabel);
+		invalidateArrayBase();
+		before = currentPathCost();
+		entryState = saveInitialised();
+		processStatements(currentStatement->whileStatements);
+		bodyState = saveInitialised();
+		mergePathCosts(before, currentPathCost());
+		emit("label WHILE_%d\n", currentLabel);
+		invalidateArrayBase();
+
+		/* The condition is checked with the variables initialised before the body and reported at the line of the loop, as in the source */
+
+		restoreInitialised(entryState);
+		curStatement = currentStatement;
+		sourceLine = currentStatement->lineNum;
+
+		if(options.annotateLines)
+			emit("// line %d\n", currentStatement->lineNum);
+
+		processCondition(currentStatement->whileCondition, true, label);
+		restoreInitialised(bodyState);
+		savedInitialisedCount = entryState;
+	}
+
+	return;
+}
+
+size_t saveInitialised()
+{
+	size_t start = savedInitialisedCount;
+	size_t count = 0;
+
+	for(variableSymbol * curVariable = currentFunction->variables; curVariable; curVariable = curVariable->nextVariable)
+		count++;
+
+	for(variableSymbol * curVariable = currentClass->variables; curVariable; curVariable = curVariable->nextVariable)
+		count++;
+
+	if(savedInitialisedCount + count > savedInitialisedCapacity) {
+		savedInitialisedCapacity = (savedInitialisedCount + count) * 2;
+
+		if(!(savedInitialised = realloc(savedInitialised, savedInitialisedCapacity * sizeof(bool)))) {
+			fprintf(stderr, "Error: Could not allocate memory for initialisation state!\n");
+			exit(MEM_ERROR);
+		}
+	}
+
+	for(variableSymbol * curVariable = currentFunction->variables; curVariable; curVariable = curVariable->nextVariable)
+		savedInitialised[savedInitialisedCount++] = curVariable->initialised;
 
-	fprintf(curFile, "label WHILE_%d\n", currentLabel);
-	processExpression(currentStatement->whileCondition);
-	fprintf(curFile, "not\nif-goto END_WHILE_%d\n", currentLabel);
-	processStatements(currentStatement->whileStatements);
-	fprintf(curFile, "goto WHILE_%d\nlabel END_WHILE_%d\n", currentLabel, currentLabel);
+	for(variableSymbol * curVariable = currentClass->variables; curVariable; curVariable = curVariable->nextVariable)
+		savedInitialised[savedInitialisedCount++] = curVariable->initialised;
+
+	return start;
+}
+
+void restoreInitialised(size_t state)
+{
+	for(variableSymbol * curVariable = currentFunction->variables; curVariable; curVariable = curVariable->nextVariable)
+		curVariable->initialised = savedInitialised[state++];
+
+	for(variableSymbol * curVariable = currentClass->variables; curVariable; curVariable = curVariable->nextVariable)
+		curVariable->initialised = savedInitialised[state++];
 
 	return;
 }
 
 void processReturnStatement(statement * currentStatement)
 {
+	if(hasTailEntry && !inlineCallee && isSelfTailCall(currentStatement, currentClass, currentFunction)) {
+		processTailCall(currentStatement->returnExpression->terms[0]->call);
+		return;
+	}
+
 	if(!strcmp(currentFunction->typeName, "void")) {
-		fprintf(curFile, "push constant 0\n");
+		emit("push constant 0\n");
 	} else {
 		if(strcmp(processExpression(currentStatement->returnExpression), currentFunction->typeName)) {
 			semanticWarning("Type of returned expression does not match the type of the function");
 		}
 	}
 
-	fprintf(curFile, "return\n");
-
-	return;
+	emit("return\n");
+
+	return;
+}
+
+void processTailCall(functionCall * call)
+{
+	int isMethod = currentFunction->type == method; /* The "this" argument of a method stays the same */
+	variableSymbol * curVariable = currentFunction->arguments;
+
+	/* All arguments are evaluated before any parameter is overwritten since they may read the old values */
+
+	for(unsigned int i = 0; i < call->expressionCount; i++, curVariable = curVariable->nextVariable)
+		if(strcmp(processExpression(call->expressionList[i]), curVariable->typeName))
+			semanticWarning("Expression type does not match parameter type");
+
+	for(unsigned int i = call->expressionCount; i > 0; i--)
+		emit("pop argument %d\n", i - 1 + isMethod);
+
+	/* Locals which may be read before being assigned expect the zero the VM gave them on entry */
+
+	for(variableSymbol * curLocal = currentFunction->variables; curLocal; curLocal = curLocal->nextVariable)
+		if(!curLocal->definedBeforeUse)
+			emit("push constant 0\npop local %d\n", curLocal->offset);
+
+	emit("goto TAIL_CALL\n");
+
+	return;
+}
+
+void processDoStatement(statement * currentStatement)
+{
+	const intrinsic * curIntrinsic;
+	functionSymbolTable * callee;
+
+	if((curIntrinsic = lookupIntrinsic(currentStatement->call, &callee))) { /* Expansions without a result leave nothing to discard */
+		curIntrinsic->expand(currentStatement->call, callee);
+
+		if(curIntrinsic->pushesValue)
+			emit("pop temp 0\n");
+
+		return;
+	}
+
+	processFunctionCall(currentStatement->call);
+	emit("pop temp 0\n");
+
+	return;
+}
+
+char * processExpression(expression * currentExpression)
+{
+	char * expressionType;
+	unsigned int position = 1;
+	unsigned int nextTerm = 1;
+
+	if(!currentExpression)
+		return "void";
+
+	if(canSwapOperands(currentExpression) && termStackDepth(currentExpression->terms[1]) > termStackDepth(currentExpression->terms[0])) {
+		char * swappedType = processTerm(currentExpression->terms[1]);
+
+		/* The deeper operand goes first, comparisons are mirrored to keep their meaning */
+
+		if(strcmp(expressionType = processTerm(currentExpression->terms[0]), swappedType))
+			semanticWarning("Term in expression has invalid type");
+
+		processOperator(FIRST_OPERATOR(currentExpression) == '<' ? '>' : FIRST_OPERATOR(currentExpression) == '>' ? '<' : FIRST_OPERATOR(currentExpression));
+		position = 3;
+		nextTerm = 2;
+	} else {
+		expressionType = processTerm(currentExpression->terms[0]);
+	}
+
+	/* The postfix is followed as it is, every operator reduces the operand just pushed so the stack only ever holds the running result and the next operand */
+
+	for(; position < currentExpression->postfixLength; position++) {
+		if(currentExpression->postfix[position] != POSTFIX_OPERAND) {
+			processOperator(currentExpression->postfix[position]);
+		} else if(strcmp(expressionType, processTerm(currentExpression->terms[nextTerm++]))) {
+			semanticWarning("Term in expression has invalid type");
+		}
+	}
+
+	return expressionType;
+}
+
+void processCondition(expression * condition, bool jumpIfTrue, const char * label)
+{
+	char skipLabel[LABEL_SIZE];
+
+	if(condition->termCount == 1) {
+		processConditionTerm(condition->terms[0], jumpIfTrue, label);
+		return;
+	}
+
+	/* Boolean operands of "&" and "|" are short-circuited, the right operand may only be skipped when it has no side effects */
+
+	if(condition->termCount == 2 && (FIRST_OPERATOR(condition) == '&' || FIRST_OPERATOR(condition) == '|') && isBooleanExpression(condition) && !termHasCalls(condition->terms[1])) {
+		if((FIRST_OPERATOR(condition) == '|') == jumpIfTrue) {
+			processConditionTerm(condition->terms[0], jumpIfTrue, label);
+			processConditionTerm(condition->terms[1], jumpIfTrue, label);
+		} else {
+			snprintf(skipLabel, LABEL_SIZE, "COND_%d", labelID++);
+
+			processConditionTerm(condition->terms[0], !jumpIfTrue, skipLabel);
+			processConditionTerm(condition->terms[1], jumpIfTrue, label);
+
+			emit("label %s\n", skipLabel);
+			invalidateArrayBase();
+		}
+
+		return;
+	}
+
+	processExpression(condition);
+	emit("%sif-goto %s\n", jumpIfTrue ? "" : "not\n", label);
+
+	return;
+}
+
+void processConditionTerm(term * curTerm, bool jumpIfTrue, const char * label)
+{
+	if(curTerm->type == expr) {
+		processCondition(curTerm->expr, jumpIfTrue, label);
+	} else if(curTerm->type == unaryTerm && curTerm->operator == '~' && isBooleanTerm(curTerm->term)) {
+		processConditionTerm(curTerm->term, !jumpIfTrue, label);
+	} else if(curTerm->type == constant && curTerm->constantType != stringType && strcmp(curTerm->constantTerm, "this")) {
+		/* Constant conditions are decided at compile time */
+
+		bool value = strcmp(curTerm->constantTerm, "true") ? atoi(curTerm->constantTerm) != 0 : true;
+
+		if(value == jumpIfTrue)
+			emit("goto %s\n", label);
+	} else {
+		processTerm(curTerm);
+		emit("%sif-goto %s\n", jumpIfTrue ? "" : "not\n", label);
+	}
+
+	return;
+}
+
+bool isBooleanExpression(expression * curExpression)
+{
+	/* Only results which are known to be 0 or -1 can be inverted or short-circuited without changing their bitwise meaning */
+
+	if(curExpression->termCount == 1)
+		return isBooleanTerm(curExpression->terms[0]);
+
+	if(curExpression->termCount != 2)
+		return false;
+
+	switch(FIRST_OPERATOR(curExpression)) {
+		case '<':
+		case '>':
+		case '=':
+			return true;
+		case '&':
+		case '|':
+			return isBooleanTerm(curExpression->terms[0]) && isBooleanTerm(curExpression->terms[1]);
+		default:
+			return false;
+	}
+}
+
+bool isBooleanTerm(term * curTerm)
+{
+	if(curTerm->type == expr)
+		return isBooleanExpression(curTerm->expr);
+	else if(curTerm->type == unaryTerm)
+		return curTerm->operator == '~' && isBooleanTerm(curTerm->term);
+	else if(curTerm->type == constant && curTerm->constantType == keywordType)
+		return !strcmp(curTerm->constantTerm, "true") || !strcmp(curTerm->constantTerm, "false");
+
+	return false;
 }
 
-void processDoStatement(statement * currentStatement)
+bool isNegatedCondition(expression * condition)
 {
-	processFunctionCall(currentStatement->call);
-	fprintf(curFile, "pop temp 0\n");
+	term * curTerm;
 
-	return;
+	while(condition->termCount == 1 && condition->terms[0]->type == expr)
+		condition = condition->terms[0]->expr;
+
+	if(condition->termCount != 1)
+		return false;
+
+	curTerm = condition->terms[0];
+
+	return curTerm->type == unaryTerm && curTerm->operator == '~' && isBooleanTerm(curTerm->term);
 }
 
-char * processExpression(expression * currentExpression)
+bool isConstantCondition(expression * condition)
 {
-	char * expressionType;
+	term * curTerm;
 
-	if(!currentExpression)
-		return "void";
+	while(condition->termCount == 1 && condition->terms[0]->type == expr)
+		condition = condition->terms[0]->expr;
 
-	expressionType = processTerm(currentExpression->terms[0]);
+	if(condition->termCount != 1)
+		return false;
 
-	for(unsigned int i = 1; i < currentExpression->termCount; i++)
-		if(strcmp(expressionType, processTerm(currentExpression->terms[i])))
-			semanticWarning("Term in expression has invalid type");
+	curTerm = condition->terms[0];
 
-	for(unsigned int j = 0; j < currentExpression->operatorCount; j++)
-		processOperator(currentExpression->operators[j]);
-		
-	return expressionType;
+	return curTerm->type == constant && curTerm->constantType != stringType && strcmp(curTerm->constantTerm, "this");
 }
 
 void processOperator(char operator)
 {
 	switch(operator) {
 		case '+':
-			fprintf(curFile, "add\n");
+			emit("add\n");
 			break;
 		case '-':
-			fprintf(curFile, "sub\n");
+			emit("sub\n");
 			break;
 		case '*':
-			fprintf(curFile, "call Math.multiply 2\n");
+			emit("call Math.multiply 2\n");
 			break;
 		case '/':
-			fprintf(curFile, "call Math.divide 2\n");
+			emit("call Math.divide 2\n");
 			break;
 		case '&':
-			fprintf(curFile, "and\n");
+			emit("and\n");
 			break;
 		case '|':
-			fprintf(curFile, "or\n");
+			emit("or\n");
 			break;
 		case '<':
-			fprintf(curFile, "lt\n");
+			emit("lt\n");
 			break;
 		case '>':
-			fprintf(curFile, "gt\n");
+			emit("gt\n");
 			break;
 		case '=':
-			fprintf(curFile, "eq\n");
+			emit("eq\n");
 			break;
 		default:
 			break;
@@ -289,36 +930,46 @@ void processOperator(char operator)
 
 char * processTerm(term * curTerm)
 {
+	int offset;
 	char * termType;
 	variableSymbol * curVariable;
 
 	if(curTerm->type == constant) {
 		if(curTerm->constantType == integerType) {
-			fprintf(curFile, "push constant %s\n", curTerm->constantTerm);
+			emit("push constant %s\n", curTerm->constantTerm);
 
 			return "int";
 		} else if(curTerm->constantType == stringType) {
-			fprintf(curFile, "push constant %zu\ncall String.new 1\n", strlen(curTerm->constantTerm));
+			if(options.poolStrings) {
+				/* Pooled literals are built by a helper subroutine on first use and then reloaded from their static slot */
 
-			for(unsigned int i = 0; curTerm->constantTerm[i]; i++)
-				fprintf(curFile, "push constant %d\ncall String.appendChar 2\n", curTerm->constantTerm[i]);
+				int slot = poolStringLiteral(curTerm->constantTerm);
+				int currentLabel = labelID++;
+
+				emit("push static %d\nif-goto STRING_%d\n", slot, currentLabel);
+				emit("call %s.$string%d 0\npop static %d\n", currentClass->name, slot, slot);
+				emit("label STRING_%d\npush static %d\n", currentLabel, slot);
+				invalidateArrayBase();
+			} else {
+				processStringLiteral(curTerm->constantTerm);
+			}
 
 			return "String";
 		} else {
 			if(!strcmp(curTerm->constantTerm, "null")) {
-				fprintf(curFile, "push constant 0\n");
+				emit("push constant 0\n");
 
 				return "int";
 			} else if(!strcmp(curTerm->constantTerm, "false")) {
-				fprintf(curFile, "push constant 0\n");
+				emit("push constant 0\n");
 
 				return "boolean";
 			} else if(!strcmp(curTerm->constantTerm, "true")) {
-				fprintf(curFile, "push constant 1\nneg\n");
+				emit("push constant 1\nneg\n");
 
 				return "boolean";
 			} else if(!strcmp(curTerm->constantTerm, "this")) {
-				fprintf(curFile, "push pointer 0\n");
+				emit("push pointer 0\n");
 
 				return currentClass->name;
 			} else {
@@ -334,30 +985,33 @@ char * processTerm(term * curTerm)
 			semanticWarning("Unary term is not a boolean or integer type");
 
 		if(curTerm->operator == '-')
-			fprintf(curFile, "neg\n");
+			emit("neg\n");
 		else if(curTerm->operator == '~')
-			fprintf(curFile, "not\n");
+			emit("not\n");
 
 		return termType;
 	} else if(curTerm->type == reference) {
+		if(inlineCallee)
+			return processInlinedReference(curTerm);
+
 		if(!(curVariable = lookupFunctionVariable(currentFunction, curTerm->variableName)) && !(curVariable = lookupClassVariable(currentClass, curTerm->variableName)))
 			semanticError("Undeclared identifier");
 
 		if(!curVariable->initialised)
 			semanticWarning("Use of variable before initialisation");
 
-		fprintf(curFile, "push ");
+		emit("push ");
 
 		if(curVariable->type == statik)
-			fprintf(curFile, "static ");
+			emit("static ");
 		else if(curVariable->type == field)
-			fprintf(curFile, "this ");
+			emit("this ");
 		else if(curVariable->isArgument)
-			fprintf(curFile, "argument ");
+			emit("argument ");
 		else 
-			fprintf(curFile, "local ");
+			emit("local ");
 
-		fprintf(curFile, "%d\n", curVariable->offset);
+		emit("%d\n", curVariable->offset);
 
 		return curVariable->typeName;
 	} else if(curTerm->type == arrayReference) {
@@ -367,25 +1021,32 @@ char * processTerm(term * curTerm)
 		if(strcmp(curVariable->typeName, "Array"))
 			semanticWarning("Attempt to dereference non-array variable as an array");
 
-		fprintf(curFile, "push ");
+		if((offset = reuseArrayBase(curVariable, curTerm->indexExpression)) >= 0) {
+			emit("push that %d\n", offset);
+
+			return "int";
+		}
+
+		emit("push ");
 
 		if(curVariable->type == statik)
-			fprintf(curFile, "static ");
+			emit("static ");
 		else if(curVariable->type == field)
-			fprintf(curFile, "this ");
+			emit("this ");
 		else if(curVariable->isArgument)
-			fprintf(curFile, "argument ");
+			emit("argument ");
 		else 
-			fprintf(curFile, "local ");
+			emit("local ");
 
-		fprintf(curFile, "%d\n", curVariable->offset);
+		emit("%d\n", curVariable->offset);
 
 		termType = processExpression(curTerm->indexExpression);
 
 		if(strcmp(termType, "int"))
 			semanticWarning("Array index is not of integer type");
 
-		fprintf(curFile, "add\npop pointer 1\npush that 0\n");
+		emit("add\npop pointer 1\npush that 0\n");
+		recordArrayBase(curVariable, curTerm->indexExpression);
 
 		return "int";
 	} else if(curTerm->type == funcCall) {
@@ -400,9 +1061,20 @@ char * processFunctionCall(functionCall * call)
 	bool isClassCall = false;
 	int myOffset = 0;
 	int dotIndex = -1;
+	char prefix[MAX_LEXEME_SIZE]; /* Name in front of the dot, copied so the call is still intact if an error is recovered from */
 	classSymbolTable * curClass;
 	functionSymbolTable * curFunction;
 	variableSymbol * curVariable;
+	const intrinsic * curIntrinsic;
+
+	if((curIntrinsic = lookupIntrinsic(call, &curFunction))) {
+		curIntrinsic->expand(call, curFunction);
+
+		if(!curIntrinsic->pushesValue) /* Keeps the stack balanced if the result of a void subroutine is used */
+			emit("push constant 0\n");
+
+		return curFunction->typeName;
+	}
 
 	for(unsigned int i = 0; i < strlen(call->actionName); i++) {
 		if(call->actionName[i] == '.') {
@@ -412,31 +1084,24 @@ char * processFunctionCall(functionCall * call)
 	}
 	
 	if(isClassCall) {
-		call->actionName[dotIndex] = '\0';
+		snprintf(prefix, sizeof(prefix), "%.*s", dotIndex, call->actionName);
 
 		/* Determine if the reference is an object or a class */
 
-		for(curClass = classes.firstClass; curClass; curClass = curClass->nextClass) {
-			if(!strcmp(curClass->name, call->actionName)) {
-				break;
-			}
-		}
-
-		if(curClass) { /* If it is a function call then we check that the function exists within that class */
+		if((curClass = lookupClass(prefix))) { /* If it is a function call then we check that the function exists within that class */
 			if(!(curFunction = lookupClassFunction(curClass, call->actionName + dotIndex + 1))) {
 				semanticError("Function does not exist");
 			}
+
+			if(curFunction->type != method && inlineFunctionCall(call, curClass, curFunction, NULL))
+				return curFunction->typeName;
 		} else { /* If not then it must be an object invoking a method, so we first check that the object exists within scope */
-			if(!(curVariable = lookupFunctionVariable(currentFunction, call->actionName)) && !(curVariable = lookupClassVariable(currentClass, call->actionName)))
+			if(!(curVariable = lookupFunctionVariable(currentFunction, prefix)) && !(curVariable = lookupClassVariable(currentClass, prefix)))
 				semanticError("Undeclared identifier");
 
 			/* Check that the object is of a class type that actuall exists and that that class contains a method of the same name */
 
-			for(curClass = classes.firstClass; curClass; curClass = curClass->nextClass)
-				if(!strcmp(curClass->name, curVariable->typeName))
-					break;
-
-			if(!curClass)
+			if(!(curClass = lookupClass(curVariable->typeName)))
 				semanticError("Variable is of unknown type");
 
 			/* Check that the type has a method of the same name */
@@ -444,18 +1109,21 @@ char * processFunctionCall(functionCall * call)
 			if(!(curFunction = lookupClassFunction(curClass, call->actionName + dotIndex + 1)))
 				semanticError("Function does not exist");
 
-			fprintf(curFile, "push ");
+			if(curFunction->type == method && inlineFunctionCall(call, curClass, curFunction, curVariable))
+				return curFunction->typeName;
+
+			emit("push ");
 
 			if(curVariable->type == statik)
-				fprintf(curFile, "static ");
+				emit("static ");
 			else if(curVariable->type == field)
-				fprintf(curFile, "this ");
+				emit("this ");
 			else if(curVariable->isArgument)
-				fprintf(curFile, "argument ");
+				emit("argument ");
 			else 
-				fprintf(curFile, "local ");
+				emit("local ");
 
-			fprintf(curFile, "%d\n", curVariable->offset);
+			emit("%d\n", curVariable->offset);
 		}
 
 		curVariable = curFunction->arguments;
@@ -464,15 +1132,18 @@ char * processFunctionCall(functionCall * call)
 			if(strcmp(processExpression(call->expressionList[i]), curVariable->typeName))
 				semanticWarning("Expression type does not match parameter type");
 
-		fprintf(curFile, "call %s.%s %d\n", curClass->name, call->actionName + dotIndex + 1, curFunction->argumentCount + myOffset);
+		emit("call %s.%s %d\n", curClass->name, call->actionName + dotIndex + 1, curFunction->argumentCount + myOffset);
 	} else {
 		if(!(curFunction = lookupClassFunction(currentClass, call->actionName)))
 			semanticError("Function does not exist");
 
+		if(inlineFunctionCall(call, currentClass, curFunction, NULL))
+			return curFunction->typeName;
+
 		if(curFunction->type != method)
 			myOffset = -2;
 
-		fprintf(curFile, "push pointer 0\n");
+		emit("push pointer 0\n");
 
 		curVariable = curFunction->arguments;
 
@@ -480,8 +1151,452 @@ char * processFunctionCall(functionCall * call)
 			if(strcmp(processExpression(call->expressionList[i]), curVariable->typeName))
 				semanticWarning("Expression type does not match parameter type");
 
-		fprintf(curFile, "call %s.%s %d\n", currentClass->name, call->actionName, curFunction->argumentCount + myOffset);
+		emit("call %s.%s %d\n", currentClass->name, call->actionName, curFunction->argumentCount + myOffset);
 	}
 	
 	return curFunction->typeName;
+}
+
+const intrinsic * lookupIntrinsic(functionCall * call, functionSymbolTable ** callee)
+{
+	char * dot = strchr(call->actionName, '.');
+	classSymbolTable * curClass;
+
+	if(!options.intrinsics || !dot)
+		return NULL;
+
+	for(unsigned int i = 0; i < sizeof(intrinsics) / sizeof(intrinsic); i++) {
+		if(strlen(intrinsics[i].className) != (size_t)(dot - call->actionName) || strncmp(intrinsics[i].className, call->actionName, dot - call->actionName) || strcmp(intrinsics[i].functionName, dot + 1) || call->expressionCount != intrinsics[i].argumentCount)
+			continue;
+
+		/* The OS class has to be part of the program, so the call is known to name its subroutine and not a method of a variable */
+
+		if((curClass = lookupClass(intrinsics[i].className)) && (*callee = lookupClassFunction(curClass, dot + 1)) && (*callee)->type == func)
+			return &intrinsics[i];
+
+		return NULL;
+	}
+
+	return NULL;
+}
+
+static void processIntrinsicArgument(functionCall * call, functionSymbolTable * callee, unsigned int index)
+{
+	variableSymbol * curArgument = callee->arguments;
+
+	for(unsigned int i = 0; i < index && curArgument; i++)
+		curArgument = curArgument->nextVariable;
+
+	if(strcmp(processExpression(call->expressionList[index]), curArgument ? curArgument->typeName : ""))
+		semanticWarning("Expression type does not match parameter type");
+
+	return;
+}
+
+static void processSelection(const char * condition, int first, int second)
+{
+	/* Leaves temp first on the stack, or temp second if the condition on the stack holds */
+
+	int currentLabel = labelID++;
+	pathCost before;
+	pathCost picked;
+
+	emit("if-goto SELECT_%d\n", currentLabel);
+
+	before = currentPathCost();
+	emit("push temp %d\ngoto SELECTED_%d\n", first, currentLabel);
+	picked = currentPathCost();
+
+	setPathCost(before);
+	emit("label SELECT_%d\npush temp %d\n%s", currentLabel, second, condition);
+	mergePathCosts(picked, currentPathCost());
+
+	emit("label SELECTED_%d\n", currentLabel);
+
+	return;
+}
+
+void expandPeek(functionCall * call, functionSymbolTable * callee)
+{
+	processIntrinsicArgument(call, callee, 0);
+	emit("pop pointer 1\npush that 0\n");
+	invalidateArrayBase();
+
+	return;
+}
+
+void expandPoke(functionCall * call, functionSymbolTable * callee)
+{
+	/* Without calls neither argument can change what the other one reads, so the value can go first and no temporary is needed */
+
+	if(!expressionHasCalls(call->expressionList[0]) && !expressionHasCalls(call->expressionList[1])) {
+		processIntrinsicArgument(call, callee, 1);
+		processIntrinsicArgument(call, callee, 0);
+		emit("pop pointer 1\npop that 0\n");
+	} else {
+		processIntrinsicArgument(call, callee, 0);
+		processIntrinsicArgument(call, callee, 1);
+		emit("pop temp 0\npop pointer 1\npush temp 0\npop that 0\n");
+	}
+
+	invalidateArrayBase();
+
+	return;
+}
+
+void expandAbs(functionCall * call, functionSymbolTable * callee)
+{
+	processIntrinsicArgument(call, callee, 0);
+	emit("pop temp 0\npush temp 0\npush constant 0\nlt\n");
+	processSelection("neg\n", 0, 0);
+
+	return;
+}
+
+void expandMin(functionCall * call, functionSymbolTable * callee)
+{
+	processIntrinsicArgument(call, callee, 0);
+	processIntrinsicArgument(call, callee, 1);
+	emit("pop temp 1\npop temp 0\npush temp 0\npush temp 1\ngt\n");
+	processSelection("", 0, 1);
+
+	return;
+}
+
+void expandMax(functionCall * call, functionSymbolTable * callee)
+{
+	processIntrinsicArgument(call, callee, 0);
+	processIntrinsicArgument(call, callee, 1);
+	emit("pop temp 1\npop temp 0\npush temp 0\npush temp 1\nlt\n");
+	processSelection("", 0, 1);
+
+	return;
+}
+
+bool decomposeIndex(expression * indexExpression, variableSymbol ** index, int * displacement)
+{
+	term * first;
+	term * second;
+
+	while(indexExpression->termCount == 1 && indexExpression->terms[0]->type == expr)
+		indexExpression = indexExpression->terms[0]->expr;
+
+	first = indexExpression->terms[0];
+	*index = NULL;
+	*displacement = 0;
+
+	/* Only indices of the form "i", "k", "i + k", "k + i" and "i - k" can be related to each other at compile time */
+
+	if(indexExpression->termCount == 2) {
+		second = indexExpression->terms[1];
+
+		if(FIRST_OPERATOR(indexExpression) == '+' && first->type == constant && first->constantType == integerType) {
+			first = second;
+			second = indexExpression->terms[0];
+		}
+
+		if(second->type != constant || second->constantType != integerType || (FIRST_OPERATOR(indexExpression) != '+' && FIRST_OPERATOR(indexExpression) != '-'))
+			return false;
+
+		*displacement = FIRST_OPERATOR(indexExpression) == '+' ? atoi(second->constantTerm) : -atoi(second->constantTerm);
+	} else if(indexExpression->termCount != 1) {
+		return false;
+	}
+
+	if(first->type == constant && first->constantType == integerType && indexExpression->termCount == 1) {
+		*displacement = atoi(first->constantTerm);
+
+		return true;
+	}
+
+	if(first->type != reference)
+		return false;
+
+	/* Fields and statics may change behind a call, so only locals and arguments are tracked */
+
+	if(!(*index = lookupFunctionVariable(currentFunction, first->variableName)) || strcmp((*index)->typeName, "int"))
+		return false;
+
+	return true;
+}
+
+int reuseArrayBase(variableSymbol * curVariable, expression * indexExpression)
+{
+	variableSymbol * index;
+	int displacement;
+
+	if(!options.trackArrayBase || inlineCallee || curVariable != thatBase.array || !decomposeIndex(indexExpression, &index, &displacement))
+		return -1;
+
+	if(index != thatBase.index || displacement < thatBase.displacement)
+		return -1;
+
+	return displacement - thatBase.displacement;
+}
+
+void recordArrayBase(variableSymbol * curVariable, expression * indexExpression)
+{
+	variableSymbol * index;
+	int displacement;
+
+	invalidateArrayBase();
+
+	if(!options.trackArrayBase || inlineCallee || curVariable->type != variable || !decomposeIndex(indexExpression, &index, &displacement))
+		return;
+
+	thatBase.array = curVariable;
+	thatBase.index = index;
+	thatBase.displacement = displacement;
+
+	return;
+}
+
+void invalidateArrayBase()
+{
+	thatBase.array = NULL;
+	thatBase.index = NULL;
+	thatBase.displacement = 0;
+
+	return;
+}
+
+void recordSourceLine(const char * line)
+{
+	if(!*line || !strncmp(line, "//", 2))
+		return;
+
+	/* Extend the last run while the source line stays the same */
+
+	if(sourceRunCount && sourceRuns[sourceRunCount - 1].lineNum == sourceLine) {
+		sourceRuns[sourceRunCount - 1].count++;
+	} else {
+		if(sourceRunCount == sourceRunCapacity) {
+			sourceRunCapacity = sourceRunCapacity ? sourceRunCapacity * 2 : 64;
+
+			if(!(sourceRuns = realloc(sourceRuns, sourceRunCapacity * sizeof(sourceRun)))) {
+				fprintf(stderr, "Error: Could not allocate memory for source map!\n");
+				exit(MEM_ERROR);
+			}
+		}
+
+		sourceRuns[sourceRunCount].start = instructionIndex;
+		sourceRuns[sourceRunCount].count = 1;
+		sourceRuns[sourceRunCount++].lineNum = sourceLine;
+	}
+
+	instructionIndex++;
+
+	return;
+}
+
+void processSourceMap(const char * filename)
+{
+	FILE * mapFile;
+
+	if(!(mapFile = options.replaceChanged ? tmpfile() : fopen(filename, "w"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", filename);
+		exit(FILE_ERROR);
+	}
+
+	/* Each run is written as [first instruction, instruction count, line] */
+
+	fprintf(mapFile, "{\"version\":1,\"class\":\"%s\",\"file\":\"", currentClass->name);
+
+	for(const char * c = currentClass->fileName ? currentClass->fileName : ""; *c; c++)
+		fprintf(mapFile, *c == '"' || *c == '\\' ? "\\%c" : "%c", *c);
+
+	fprintf(mapFile, "\",\"instructions\":%d,\"runs\":[", instructionIndex);
+
+	for(int i = 0; i < sourceRunCount; i++)
+		fprintf(mapFile, "%s[%d,%d,%d]", i ? "," : "", sourceRuns[i].start, sourceRuns[i].count, sourceRuns[i].lineNum);
+
+	fprintf(mapFile, "]}\n");
+
+	if(options.replaceChanged)
+		replaceOutput(mapFile, filename);
+
+	fclose(mapFile);
+
+	return;
+}
+
+bool replaceOutput(FILE * generated, const char * filename)
+{
+	FILE * oldFile;
+	FILE * newFile;
+	char * temporaryName;
+	char generatedBlock[BUFSIZ];
+	char oldBlock[BUFSIZ];
+	size_t length;
+	bool changed = false;
+
+	/* Files which would come out the same are left alone, so their timestamps only move when something downstream has to be redone */
+
+	rewind(generated);
+
+	if((oldFile = fopen(filename, "rb"))) {
+		do {
+			length = fread(generatedBlock, 1, sizeof(generatedBlock), generated);
+			changed = fread(oldBlock, 1, sizeof(oldBlock), oldFile) != length || memcmp(generatedBlock, oldBlock, length);
+		} while(!changed && length == sizeof(generatedBlock));
+
+		fclose(oldFile);
+
+		if(!changed)
+			return false;
+
+		rewind(generated);
+	}
+
+	/* Renaming a complete file over the old one means readers see either version but never a partial one */
+
+	if(!(temporaryName = calloc(strlen(filename) + 5, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	sprintf(temporaryName, "%s.tmp", filename);
+
+	if(!(newFile = fopen(temporaryName, "wb"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", temporaryName);
+		exit(FILE_ERROR);
+	}
+
+	while((length = fread(generatedBlock, 1, sizeof(generatedBlock), generated)))
+		fwrite(generatedBlock, 1, length, newFile);
+
+	if(fclose(newFile) || rename(temporaryName, filename)) {
+		fprintf(stderr, "Error: Could not write file \"%s\"!\n", filename);
+		remove(temporaryName);
+		exit(FILE_ERROR);
+	}
+
+	free(temporaryName);
+	outputsReplaced++;
+
+	return true;
+}
+
+void freeSourceMap()
+{
+	free(sourceRuns);
+
+	sourceRuns = NULL;
+	sourceRunCount = sourceRunCapacity = 0;
+
+	return;
+}
+
+void processStringLiteral(char * literal)
+{
+	emit("push constant %zu\ncall String.new 1\n", strlen(literal));
+
+	for(unsigned int i = 0; literal[i]; i++)
+		emit("push constant %d\ncall String.appendChar 2\n", literal[i]);
+
+	return;
+}
+
+int poolStringLiteral(char * literal)
+{
+	pooledString * curString;
+
+	for(curString = stringPool; curString; curString = curString->nextString)
+		if(!strcmp(curString->literal, literal))
+			return curString->slot;
+
+	if(!(curString = calloc(1, sizeof(pooledString)))) {
+		fprintf(stderr, "Error: Could not allocate memory for string pool!\n");
+		exit(MEM_ERROR);
+	}
+
+	curString->literal = literal;
+	curString->slot = lastPooledString ? lastPooledString->slot + 1 : currentClass->staticCount; /* Pool slots follow the static variables of the class */
+
+	if(!lastPooledString) {
+		stringPool = lastPooledString = curString;
+	} else {
+		lastPooledString->nextString = curString;
+		lastPooledString = curString;
+	}
+
+	return curString->slot;
+}
+
+void processStringPool()
+{
+	/* Each pooled literal gets its own builder subroutine, "$" cannot appear in a Jack identifier so these never clash with user code */
+
+	for(pooledString * curString = stringPool; curString; curString = curString->nextString) {
+		emit("function %s.$string%d 0\n", currentClass->name, curString->slot);
+		processStringLiteral(curString->literal);
+		emit("return\n");
+	}
+
+	return;
+}
+
+void freeStringPool()
+{
+	pooledString * nextString;
+
+	for(pooledString * curString = stringPool; curString; curString = nextString) {
+		nextString = curString->nextString;
+		free(curString);
+	}
+
+	stringPool = lastPooledString = NULL;
+
+	return;
+}
+
+void abandonStatement()
+{
+	/* Nothing generated after an error is written, but the state an expression or an inlined call left half way must not confuse the statements still checked */
+
+	if(inlineCallee) {
+		currentClass = inlineCallerClass;
+		currentFunction = inlineCaller;
+		inlineCallee = NULL;
+	}
+
+	discardOutput();
+	pendingLength = 0;
+	invalidateArrayBase();
+
+	return;
+}
+
+void discardOutput()
+{
+	/* A class cut short by an error is not left behind as a truncated file, a temporary file simply goes away when it is closed */
+
+	if(curFile)
+		fclose(curFile);
+
+	if(curFileName)
+		remove(curFileName);
+
+	curFile = NULL;
+	curFileName = NULL;
+
+	return;
+}
+
+void abandonClass()
+{
+	/* Generation of the current class ended in an error which was recovered from, none of its state may leak into the next class */
+
+	freeStringPool();
+	freeSourceMap();
+	freeBytecode(&classBytecode);
+	discardOutput();
+
+	inlineCallerClass = NULL;
+	inlineCaller = inlineCallee = NULL;
+	inlineReceiver = NULL;
+	inlineArguments = NULL;
+	currentNodePool = NULL;
+
+	return;
 }
\ No newline at end of file
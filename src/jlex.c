@@ -5,6 +5,7 @@
 
 #include "../include/jack.h"
 #include "../include/jlex.h"
+#include "../include/jscan.h"
 
 const char * const tokenTypeNames[] = { "keyword",
 										"identifier",
@@ -42,8 +43,16 @@ const char * const operators = "+-*/&|~<>=";
 const char * const punctuators = "({[]}),.;";
 
 int lineNum = 1;
+unsigned long tokenCount = 0; /* Tokens consumed by getNextToken, peeks are not counted twice */
 token peekedToken = { 0 };
-long int peekOffset = 0;
+size_t peekOffset = 0;
+
+/* The whole source file is held in memory so that whitespace and comments can be skipped a block at a time */
+
+char * sourceBuffer = NULL;
+size_t sourceLength = 0;
+size_t sourcePosition = 0;
+const sourceScanner * scanner = NULL;
 
 static inline bool isoperator(int c)
 {
@@ -72,51 +81,105 @@ static inline bool iskeyword(char * string)
 	return false;
 }
 
+void loadSource(FILE * file)
+{
+	long size;
+
+	freeSource();
+
+	if(!scanner)
+		scanner = selectScanner();
+
+	if(fseek(file, 0, SEEK_END) || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET)) {
+		fprintf(stderr, "Error: Could not determine the size of \'%s\'!\n", sourceFileName);
+		exit(FILE_ERROR);
+	}
+
+	if(!(sourceBuffer = calloc(size + SCAN_PADDING, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for source file!\n");
+		exit(MEM_ERROR);
+	}
+
+	sourceLength = fread(sourceBuffer, 1, size, file);
+	sourcePosition = peekOffset = 0;
+	lineNum = 1;
+
+	return;
+}
+
+void loadSourceText(const char * text, size_t length)
+{
+	freeSource();
+
+	if(!scanner)
+		scanner = selectScanner();
+
+	if(!(sourceBuffer = calloc(length + SCAN_PADDING, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for source file!\n");
+		exit(MEM_ERROR);
+	}
+
+	memcpy(sourceBuffer, text, length);
+	sourceLength = length;
+	sourcePosition = peekOffset = 0;
+	lineNum = 1;
+
+	return;
+}
+
+void freeSource()
+{
+	free(sourceBuffer);
+
+	sourceBuffer = NULL;
+	sourceLength = sourcePosition = peekOffset = 0;
+
+	return;
+}
+
+const char * scannerName()
+{
+	return (scanner ? scanner : selectScanner())->name;
+}
+
 static int _getNextToken(token * nextToken)
 {
-	bool inSingleComment = false;
-	bool inMultiComment = false;
+	size_t start;
 	int c;
 
-	/* Strip all whitespace and comments preceeding a token */
-
-	do {
-		c = fgetc(sourceFile);
-
-		if(c == '/') {
-			if((c = fgetc(sourceFile)) == '/') {
-				inSingleComment = true;
-			} else if(c == '*') {
-				inMultiComment = true;
-			} else {
-				ungetc(c, sourceFile);
-				c = '/';
-			}
-		} else if(c == '*' && inMultiComment) {
-			if((c = fgetc(sourceFile)) == '/') {
-				inMultiComment = false;
-				c = fgetc(sourceFile);
-			}
-		}
+	/* Strip all whitespace and comments preceeding a token, the padding after the source ends any lookahead */
 
-		if(c == '\n') {
-			lineNum++;
-			if(inSingleComment) {
-				inSingleComment = false;
-			}
-		}
-	} while(isspace(c) || ((inSingleComment || inMultiComment) && c != EOF));
+	for(;;) {
+		/* Tokens are mostly separated by a single space, which is not worth starting a block scan for */
+
+		if(sourceBuffer[sourcePosition] == ' ' && !isspace((unsigned char)sourceBuffer[sourcePosition + 1]))
+			sourcePosition++;
+		else if(isspace((unsigned char)sourceBuffer[sourcePosition]))
+			sourcePosition = scanner->skipWhitespace(sourceBuffer, sourcePosition, sourceLength, &lineNum);
+
+		if(sourceBuffer[sourcePosition] == '/' && sourceBuffer[sourcePosition + 1] == '/')
+			sourcePosition = scanner->findLineEnd(sourceBuffer, sourcePosition + 2, sourceLength);
+		else if(sourceBuffer[sourcePosition] == '/' && sourceBuffer[sourcePosition + 1] == '*')
+			sourcePosition = scanner->findCommentEnd(sourceBuffer, sourcePosition + 2, sourceLength, &lineNum);
+		else
+			break;
+	}
 
 	nextToken->lineNum = lineNum;
-	nextToken->character = c;
 
 	/* Check if the lexeme is a single character */
 
-	if(c == EOF) {
+	if(sourcePosition >= sourceLength) {
+		nextToken->character = EOF;
 		nextToken->type = terminator;
 		lineNum = 1;
 		return EXEC_SUCCESS;
-	} else if(isoperator(c)) {
+	}
+
+	c = (unsigned char)sourceBuffer[sourcePosition++];
+	nextToken->character = c;
+
+	if(isoperator(c)) {
 		nextToken->type = operator;
 		return EXEC_SUCCESS;
 	} else if(ispunctuator(c)) {
@@ -124,18 +187,15 @@ static int _getNextToken(token * nextToken)
 		return EXEC_SUCCESS;
 	}
 
-	/* If it's not a single character then the lexeme must be multi-character and we will need additional storage */
+	/* If it's not a single character then the lexeme must be multi-character and is copied straight out of the source */
 
-	int pos = 0;
-	char tempString[MAX_LEXEME_SIZE] = { '\0' };
+	start = sourcePosition - 1;
 
 	if(isdigit(c)) { 
-		do {
-			tempString[pos++] = c;
-			c = fgetc(sourceFile);
-		} while(isdigit(c) && pos < MAX_LEXEME_SIZE - 1);
+		while(isdigit((unsigned char)sourceBuffer[sourcePosition]) && sourcePosition - start < MAX_LEXEME_SIZE - 1)
+			sourcePosition++;
 
-		ungetc(c, sourceFile);
+		c = sourcePosition < sourceLength ? (unsigned char)sourceBuffer[sourcePosition] : EOF;
 
 		if(!isoperator(c) && !ispunctuator(c) && !isspace(c)) {
 			return LEX_ERROR;
@@ -143,31 +203,36 @@ static int _getNextToken(token * nextToken)
 
 		nextToken->type = integer;
 	} else if(c == '"') {
-		do {
-			c = fgetc(sourceFile);
-			tempString[pos++] = c;
+		start = sourcePosition;
 
-			if(c == '\n' || c == EOF) {
+		while(sourcePosition < sourceLength && sourceBuffer[sourcePosition] != '"' && sourcePosition - start < MAX_LEXEME_SIZE - 2) {
+			if(sourceBuffer[sourcePosition] == '\n')
 				return LEX_ERROR;
-			}
-		} while(c != '"' && pos < MAX_LEXEME_SIZE - 2);
 
-		tempString[--pos] = '\0';
+			sourcePosition++;
+		}
+
+		if(sourcePosition >= sourceLength)
+			return LEX_ERROR;
+
 		nextToken->type = string;
 	} else { /* If it's not a number or a string literal then the it must be either an identifier or a keyword */
-		do {
-			tempString[pos++] = c;
-			c = fgetc(sourceFile);
-		} while((isalpha(c) || isdigit(c) || c == '_') && pos < MAX_LEXEME_SIZE - 1);
+		while((isalnum((unsigned char)sourceBuffer[sourcePosition]) || sourceBuffer[sourcePosition] == '_') && sourcePosition - start < MAX_LEXEME_SIZE - 1)
+			sourcePosition++;
 
-		ungetc(c, sourceFile);
-		nextToken->type = (iskeyword(tempString) ? keyword : identifier);
+		nextToken->type = identifier;
 	}
 
-	if(!(nextToken->string = malloc(strlen(tempString) + 1)))
+	if(!(nextToken->string = malloc(sourcePosition - start + 1)))
 		return MEM_ERROR;
 
-	memcpy(nextToken->string, tempString, strlen(tempString) + 1);
+	memcpy(nextToken->string, sourceBuffer + start, sourcePosition - start);
+	nextToken->string[sourcePosition - start] = '\0';
+
+	if(nextToken->type == string && sourceBuffer[sourcePosition] == '"')
+		sourcePosition++; /* Step over the closing quote */
+	else if(nextToken->type == identifier && iskeyword(nextToken->string))
+		nextToken->type = keyword;
 
 	return EXEC_SUCCESS;
 }
@@ -179,13 +244,13 @@ static int _peekNextToken(token * currToken)
 		return EXEC_SUCCESS;
 	}
 
-	long int curPos = ftell(sourceFile); /* If it hasn't then we will need to find the current position in the file to move back to once we've extracted it */
+	size_t curPos = sourcePosition; /* If it hasn't then we will need to remember the current position in the source to move back to once we've extracted it */
 	int lexerStatus = _getNextToken(currToken);
 
-	peekOffset = ftell(sourceFile);
+	peekOffset = sourcePosition;
 
 	memcpy(&peekedToken, currToken, sizeof(token));
-	fseek(sourceFile, curPos, SEEK_SET); /* Move back to the begining of the token */
+	sourcePosition = curPos; /* Move back to the begining of the token */
 
 	return lexerStatus;
 }
@@ -194,22 +259,43 @@ void getNextToken(token * currToken)
 {
 	if(peekOffset) {
 		memcpy(currToken, &peekedToken, sizeof(token)); /* As above, if we've already extracted the token then just send it again */
-		fseek(sourceFile, peekOffset, SEEK_SET); /* Since the file position will be before the current token we need to move it to the end of the token */
+		sourcePosition = peekOffset; /* Since the source position will be before the current token we need to move it to the end of the token */
 
 		peekOffset = 0;
+		tokenCount++;
 
 		return;
 	}
 
 	if(_getNextToken(currToken) != EXEC_SUCCESS) {
+		if(diagnosticHook)
+			raiseDiagnostic(severityError, "Invalid token", lineNum);
+
 		fprintf(stderr, "Error: Could not get next token!\n");
 		exit(LEX_ERROR);
 	}
+
+	tokenCount++;
+}
+
+void ungetToken(token * currToken)
+{
+	/* The token becomes the peeked one again, the source position already lies at its end where getNextToken moves to */
+
+	if(peekOffset) /* Only peeked so far, it is still the next token */
+		return;
+
+	memcpy(&peekedToken, currToken, sizeof(token));
+	peekOffset = sourcePosition;
+	tokenCount--;
 }
 
 void peekNextToken(token * currToken)
 {
 	if(_peekNextToken(currToken) != EXEC_SUCCESS) {
+		if(diagnosticHook)
+			raiseDiagnostic(severityError, "Invalid token", lineNum);
+
 		fprintf(stderr, "Error: Could not get next token!\n");
 		exit(LEX_ERROR);
 	}
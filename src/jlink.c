@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jasm.h"
+#include "../include/jgen.h"
+#include "../include/jlink.h"
+#include "../include/jvmb.h"
+
+linkedFunction * linkedFunctions = NULL;
+int linkedFunctionCount = 0;
+int linkedFunctionCapacity = 0;
+int linkedStaticCount = 0; /* Static slots taken by the classes collected so far */
+
+linkedFunction ** sortedFunctions = NULL; /* Sorted by name for the call graph walk */
+vmbBuffer linkedBytecode = { 0 };
+
+void collectLinkedClass(const char * className, FILE * classFile)
+{
+	char line[MAX_COMMAND_SIZE];
+	char command[16];
+	char segment[16];
+	int index;
+	int staticCount = 0;
+	linkedFunction * curFunction = NULL;
+
+	/* The first pass sizes the static segment of the class, which includes the slots of pooled strings */
+
+	rewind(classFile);
+
+	while(fgets(line, MAX_COMMAND_SIZE, classFile))
+		if(sscanf(line, "%15s %15s %d", command, segment, &index) == 3 && !strcmp(segment, "static") && index >= staticCount)
+			staticCount = index + 1;
+
+	if(linkedStaticCount + staticCount > MAX_STATIC_COUNT) {
+		fprintf(stderr, "Error: Static variables of class \"%s\" do not fit into the static segment of the linked program!\n", className);
+		exit(SEMANTIC_ERROR);
+	}
+
+	rewind(classFile);
+
+	while(fgets(line, MAX_COMMAND_SIZE, classFile)) {
+		if(!strncmp(line, "function ", 9)) {
+			if(linkedFunctionCount == linkedFunctionCapacity) {
+				linkedFunctionCapacity = linkedFunctionCapacity ? linkedFunctionCapacity * 2 : 64;
+
+				if(!(linkedFunctions = realloc(linkedFunctions, linkedFunctionCapacity * sizeof(linkedFunction)))) {
+					fprintf(stderr, "Error: Could not allocate memory for linked program!\n");
+					exit(MEM_ERROR);
+				}
+			}
+
+			curFunction = &linkedFunctions[linkedFunctionCount++];
+			memset(curFunction, 0, sizeof(linkedFunction));
+
+			if(!(curFunction->name = calloc(strlen(line), 1))) {
+				fprintf(stderr, "Error: Could not allocate memory for linked program!\n");
+				exit(MEM_ERROR);
+			}
+
+			sscanf(line + 9, "%s", curFunction->name);
+		}
+
+		if(!curFunction)
+			continue;
+
+		if(sscanf(line, "%15s %15s %d", command, segment, &index) == 3 && !strcmp(segment, "static"))
+			snprintf(line, MAX_COMMAND_SIZE, "%s static %d\n", command, linkedStaticCount + index);
+
+		appendLinkedText(curFunction, line);
+	}
+
+	linkedStaticCount += staticCount;
+
+	return;
+}
+
+void appendLinkedText(linkedFunction * curFunction, const char * text)
+{
+	size_t length = strlen(text);
+
+	if(curFunction->length + length + 1 > curFunction->capacity) {
+		curFunction->capacity = (curFunction->length + length + 1) * 2;
+
+		if(!(curFunction->text = realloc(curFunction->text, curFunction->capacity))) {
+			fprintf(stderr, "Error: Could not allocate memory for linked program!\n");
+			exit(MEM_ERROR);
+		}
+	}
+
+	memcpy(curFunction->text + curFunction->length, text, length + 1);
+	curFunction->length += length;
+
+	return;
+}
+
+static int compareLinkedFunctions(const void * first, const void * second)
+{
+	return strcmp((*(linkedFunction * const *)first)->name, (*(linkedFunction * const *)second)->name);
+}
+
+linkedFunction * lookupLinkedFunction(const char * name)
+{
+	linkedFunction key = { 0 };
+	linkedFunction * keyPointer = &key;
+	linkedFunction ** found;
+
+	key.name = (char *)name;
+	found = bsearch(&keyPointer, sortedFunctions, linkedFunctionCount, sizeof(linkedFunction *), compareLinkedFunctions);
+
+	return found ? *found : NULL;
+}
+
+void linkProgram(const char * filename)
+{
+	FILE * linkFile;
+	linkedFunction * entry;
+	size_t length = strlen(filename);
+	linkFormat format = linkText;
+
+	if(length > 4 && !strcmp(filename + length - 4, ".asm"))
+		format = linkAssembly;
+	else if(length > 4 && !strcmp(filename + length - 4, ".vmb"))
+		format = linkBytecode;
+
+	if(!(sortedFunctions = calloc(linkedFunctionCount + 1, sizeof(linkedFunction *)))) {
+		fprintf(stderr, "Error: Could not allocate memory for linked program!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(int i = 0; i < linkedFunctionCount; i++)
+		sortedFunctions[i] = &linkedFunctions[i];
+
+	qsort(sortedFunctions, linkedFunctionCount, sizeof(linkedFunction *), compareLinkedFunctions);
+
+	if(!(linkFile = fopen(filename, format == linkBytecode ? "wb" : "w"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", filename);
+		exit(FILE_ERROR);
+	}
+
+	/* Programs without the OS start directly in Main.main */
+
+	if(!(entry = lookupLinkedFunction("Sys.init")) && !(entry = lookupLinkedFunction("Main.main"))) {
+		fprintf(stderr, "Error: Linked program has neither Sys.init nor Main.main!\n");
+		exit(SEMANTIC_ERROR);
+	}
+
+	if(format == linkAssembly)
+		translateBootstrap(linkFile, entry->name);
+
+	/* Subroutines are laid out depth first along the call graph from the entry point, so callees follow their callers */
+
+	placeFunction(entry, linkFile, format);
+
+	for(int i = 0; i < linkedFunctionCount; i++)
+		if(!linkedFunctions[i].placed)
+			placeFunction(&linkedFunctions[i], linkFile, format);
+
+	if(format == linkBytecode) {
+		writeBytecode(&linkedBytecode, linkFile);
+		freeBytecode(&linkedBytecode);
+	}
+
+	fclose(linkFile);
+
+	return;
+}
+
+void placeFunction(linkedFunction * curFunction, FILE * linkFile, linkFormat format)
+{
+	char line[MAX_COMMAND_SIZE];
+	char callee[MAX_COMMAND_SIZE];
+	linkedFunction * calledFunction;
+
+	curFunction->placed = true;
+
+	if(format == linkText) {
+		fputs(curFunction->text, linkFile);
+	} else {
+		for(char * text = curFunction->text, * end; *text; text = end + 1) {
+			end = strchr(text, '\n');
+			memcpy(line, text, end - text);
+			line[end - text] = '\0';
+
+			if(format == linkAssembly)
+				translateCommand(linkFile, line);
+			else
+				encodeCommand(&linkedBytecode, line);
+		}
+	}
+
+	for(char * text = curFunction->text; (text = strstr(text, "call ")); text += 5)
+		if((text == curFunction->text || text[-1] == '\n') && sscanf(text + 5, "%s", callee) == 1 && (calledFunction = lookupLinkedFunction(callee)) && !calledFunction->placed)
+			placeFunction(calledFunction, linkFile, format);
+
+	return;
+}
+
+void freeLinkedProgram()
+{
+	for(int i = 0; i < linkedFunctionCount; i++) {
+		free(linkedFunctions[i].name);
+		free(linkedFunctions[i].text);
+	}
+
+	free(linkedFunctions);
+	free(sortedFunctions);
+
+	linkedFunctions = NULL;
+	sortedFunctions = NULL;
+	linkedFunctionCount = linkedFunctionCapacity = linkedStaticCount = 0;
+
+	return;
+}
\ No newline at end of file
@@ -0,0 +1,679 @@
+#include <dirent.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../include/jack.h"
+#include "../include/jlex.h"
+#include "../include/jparse.h"
+#include "../include/jsym.h"
+#include "../include/jgen.h"
+#include "../include/jlsp.h"
+
+extern classList classes;
+extern classSymbolTable * currentClass;
+extern functionSymbolTable * currentFunction;
+extern statement * curStatement;
+extern nodePool * currentNodePool;
+
+static lspDiagnostic * diagnostics = NULL;
+static lspDiagnostic * lastDiagnostic = NULL;
+static const char * diagnosticPath = NULL; /* Only diagnostics raised in the class parsed from this file are kept, NULL keeps all of them */
+static bool shutdownRequested = false;
+
+/* Functions for reading and writing protocol messages */
+
+char * readMessage()
+{
+	char header[LSP_HEADER_SIZE];
+	long length = -1;
+	char * message;
+
+	/* Headers end with an empty line, only the content length is of interest */
+
+	while(fgets(header, sizeof(header), stdin)) {
+		if(!strcmp(header, "\r\n") || !strcmp(header, "\n")) {
+			if(length >= 0)
+				break;
+		} else if(!strncmp(header, "Content-Length:", 15)) {
+			length = atol(header + 15);
+		}
+	}
+
+	if(length < 0 || feof(stdin))
+		return NULL;
+
+	if(!(message = malloc(length + 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for message!\n");
+		exit(MEM_ERROR);
+	}
+
+	if(fread(message, 1, length, stdin) != (size_t)length) {
+		free(message);
+		return NULL;
+	}
+
+	message[length] = '\0';
+
+	return message;
+}
+
+void writeMessage(jsonBuffer * body)
+{
+	printf("Content-Length: %zu\r\n\r\n%s", body->length, body->text);
+	fflush(stdout);
+
+	free(body->text);
+	body->text = NULL;
+	body->length = body->capacity = 0;
+
+	return;
+}
+
+void appendJson(jsonBuffer * buffer, const char * format, ...)
+{
+	va_list arguments;
+	int length;
+
+	va_start(arguments, format);
+	length = vsnprintf(NULL, 0, format, arguments);
+	va_end(arguments);
+
+	if(buffer->length + length + 1 > buffer->capacity) {
+		size_t capacity = buffer->capacity ? buffer->capacity : LSP_HEADER_SIZE;
+
+		while(buffer->length + length + 1 > capacity)
+			capacity *= 2;
+
+		if(!(buffer->text = realloc(buffer->text, capacity))) {
+			fprintf(stderr, "Error: Could not allocate memory for message!\n");
+			exit(MEM_ERROR);
+		}
+
+		buffer->capacity = capacity;
+	}
+
+	va_start(arguments, format);
+	vsnprintf(buffer->text + buffer->length, length + 1, format, arguments);
+	va_end(arguments);
+
+	buffer->length += length;
+
+	return;
+}
+
+void appendJsonString(jsonBuffer * buffer, const char * string)
+{
+	appendJson(buffer, "\"");
+
+	for(; *string; string++) {
+		if(*string == '"' || *string == '\\')
+			appendJson(buffer, "\\%c", *string);
+		else if(*string == '\n')
+			appendJson(buffer, "\\n");
+		else if((unsigned char)*string < ' ')
+			appendJson(buffer, "\\u%04x", (unsigned char)*string);
+		else
+			appendJson(buffer, "%c", *string);
+	}
+
+	appendJson(buffer, "\"");
+
+	return;
+}
+
+/* Functions for picking values out of a message without building a document tree */
+
+static const char * skipJsonSpace(const char * value)
+{
+	while(*value == ' ' || *value == '\t' || *value == '\r' || *value == '\n')
+		value++;
+
+	return value;
+}
+
+const char * skipJsonValue(const char * value)
+{
+	char close;
+
+	value = skipJsonSpace(value);
+
+	switch(*value) {
+		case '"':
+			for(value++; *value && *value != '"'; value++)
+				if(*value == '\\' && value[1])
+					value++;
+
+			return *value ? value + 1 : NULL;
+		case '{':
+		case '[':
+			close = *value == '{' ? '}' : ']';
+			value = skipJsonSpace(value + 1);
+
+			if(*value == close)
+				return value + 1;
+
+			for(;;) {
+				if(close == '}') { /* Members are a key and a colon in front of the value */
+					if(!(value = skipJsonValue(value)) || *(value = skipJsonSpace(value)) != ':')
+						return NULL;
+
+					value++;
+				}
+
+				if(!(value = skipJsonValue(value)))
+					return NULL;
+
+				value = skipJsonSpace(value);
+
+				if(*value != ',')
+					return *value == close ? value + 1 : NULL;
+
+				value++;
+			}
+		case '\0':
+			return NULL;
+		default: /* Numbers, true, false and null */
+			while(*value && !strchr(",}] \t\r\n", *value))
+				value++;
+
+			return value;
+	}
+}
+
+const char * findJsonMember(const char * object, const char * path)
+{
+	/* Members of nested objects are named by a path such as "params.textDocument.uri" */
+
+	while(*path) {
+		size_t keyLength = strcspn(path, ".");
+
+		object = skipJsonSpace(object);
+
+		if(*object != '{')
+			return NULL;
+
+		for(object = skipJsonSpace(object + 1);; object = skipJsonSpace(object + 1)) {
+			const char * key = object;
+
+			if(*key != '"' || !(object = skipJsonValue(key)))
+				return NULL;
+
+			bool found = (size_t)(object - key - 2) == keyLength && !strncmp(key + 1, path, keyLength);
+
+			if(*(object = skipJsonSpace(object)) != ':')
+				return NULL;
+
+			object = skipJsonSpace(object + 1);
+
+			if(found)
+				break;
+
+			if(!(object = skipJsonValue(object)) || *(object = skipJsonSpace(object)) != ',')
+				return NULL;
+		}
+
+		path += keyLength + (path[keyLength] == '.');
+	}
+
+	return skipJsonSpace(object);
+}
+
+static void appendUtf8(char ** text, unsigned long codePoint)
+{
+	if(codePoint < 0x80) {
+		*(*text)++ = codePoint;
+	} else if(codePoint < 0x800) {
+		*(*text)++ = 0xC0 | (codePoint >> 6);
+		*(*text)++ = 0x80 | (codePoint & 0x3F);
+	} else if(codePoint < 0x10000) {
+		*(*text)++ = 0xE0 | (codePoint >> 12);
+		*(*text)++ = 0x80 | ((codePoint >> 6) & 0x3F);
+		*(*text)++ = 0x80 | (codePoint & 0x3F);
+	} else {
+		*(*text)++ = 0xF0 | (codePoint >> 18);
+		*(*text)++ = 0x80 | ((codePoint >> 12) & 0x3F);
+		*(*text)++ = 0x80 | ((codePoint >> 6) & 0x3F);
+		*(*text)++ = 0x80 | (codePoint & 0x3F);
+	}
+
+	return;
+}
+
+char * readJsonString(const char * value)
+{
+	const char * end;
+	char * string;
+	char * text;
+
+	if(!value || *(value = skipJsonSpace(value)) != '"' || !(end = skipJsonValue(value)))
+		return NULL;
+
+	/* Decoding never makes the text longer than its escaped form */
+
+	if(!(string = text = malloc(end - value))) {
+		fprintf(stderr, "Error: Could not allocate memory for message!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(value++; value < end - 1; value++) {
+		if(*value != '\\') {
+			*text++ = *value;
+			continue;
+		}
+
+		switch(*++value) {
+			case 'b':
+				*text++ = '\b';
+				break;
+			case 'f':
+				*text++ = '\f';
+				break;
+			case 'n':
+				*text++ = '\n';
+				break;
+			case 'r':
+				*text++ = '\r';
+				break;
+			case 't':
+				*text++ = '\t';
+				break;
+			case 'u': {
+				unsigned long codePoint = strtoul((char[5]){ value[1], value[2], value[3], value[4], '\0' }, NULL, 16);
+
+				value += 4;
+
+				if(codePoint >= 0xD800 && codePoint < 0xDC00 && value[1] == '\\' && value[2] == 'u') { /* Characters outside the basic plane come as a surrogate pair */
+					unsigned long low = strtoul((char[5]){ value[3], value[4], value[5], value[6], '\0' }, NULL, 16);
+
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					value += 6;
+				}
+
+				appendUtf8(&text, codePoint);
+				break;
+			}
+			default: /* Quotes, backslashes and slashes stand for themselves */
+				*text++ = *value;
+				break;
+		}
+	}
+
+	*text = '\0';
+
+	return string;
+}
+
+/* Functions for collecting diagnostics */
+
+void collectDiagnostic(diagnosticSeverity severity, const char * message, int lineNum)
+{
+	lspDiagnostic * curDiagnostic;
+
+	if(diagnosticPath && !(currentClass && currentClass->fileName && !strcmp(currentClass->fileName, diagnosticPath)))
+		return;
+
+	if(!(curDiagnostic = calloc(1, sizeof(lspDiagnostic))) || !(curDiagnostic->message = calloc(strlen(message) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for diagnostic!\n");
+		exit(MEM_ERROR);
+	}
+
+	strcpy(curDiagnostic->message, message);
+	curDiagnostic->severity = severity;
+	curDiagnostic->lineNum = lineNum;
+
+	if(!lastDiagnostic) {
+		diagnostics = lastDiagnostic = curDiagnostic;
+	} else {
+		lastDiagnostic->nextDiagnostic = curDiagnostic;
+		lastDiagnostic = curDiagnostic;
+	}
+
+	return;
+}
+
+void freeDiagnostics()
+{
+	lspDiagnostic * nextDiagnostic;
+
+	for(lspDiagnostic * curDiagnostic = diagnostics; curDiagnostic; curDiagnostic = nextDiagnostic) {
+		nextDiagnostic = curDiagnostic->nextDiagnostic;
+		free(curDiagnostic->message);
+		free(curDiagnostic);
+	}
+
+	diagnostics = lastDiagnostic = NULL;
+
+	return;
+}
+
+void publishDiagnostics(const char * uri)
+{
+	jsonBuffer body = { 0 };
+
+	appendJson(&body, "{\"jsonrpc\":\"2.0\",\"method\":\"textDocument/publishDiagnostics\",\"params\":{\"uri\":");
+	appendJsonString(&body, uri);
+	appendJson(&body, ",\"diagnostics\":[");
+
+	/* Source lines count from one, protocol lines from zero, and the whole line is marked */
+
+	for(lspDiagnostic * curDiagnostic = diagnostics; curDiagnostic; curDiagnostic = curDiagnostic->nextDiagnostic) {
+		int line = curDiagnostic->lineNum > 0 ? curDiagnostic->lineNum - 1 : 0;
+
+		appendJson(&body, "%s{\"range\":{\"start\":{\"line\":%d,\"character\":0},\"end\":{\"line\":%d,\"character\":0}},\"severity\":%d,\"source\":\"jcomp\",\"message\":", curDiagnostic == diagnostics ? "" : ",", line, line + 1, curDiagnostic->severity);
+		appendJsonString(&body, curDiagnostic->message);
+		appendJson(&body, "}");
+	}
+
+	appendJson(&body, "]}}");
+	writeMessage(&body);
+
+	return;
+}
+
+/* Functions for keeping the classes of the workspace up to date */
+
+static char * uriToPath(const char * uri)
+{
+	char * path;
+	char * text;
+	char resolved[PATH_MAX];
+
+	if(!strncmp(uri, "file://", 7))
+		uri += 7;
+
+	if(!(path = text = calloc(strlen(uri) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(; *uri; uri++) {
+		if(*uri == '%' && uri[1] && uri[2]) {
+			*text++ = strtoul((char[3]){ uri[1], uri[2], '\0' }, NULL, 16);
+			uri += 2;
+		} else {
+			*text++ = *uri;
+		}
+	}
+
+	/* Classes remember the canonical path they were loaded from, documents never saved to disk keep theirs */
+
+	if(realpath(path, resolved) && strlen(resolved) <= strlen(path)) {
+		strcpy(path, resolved);
+	} else if(realpath(path, resolved)) {
+		free(path);
+
+		if(!(path = calloc(strlen(resolved) + 1, 1))) {
+			fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+			exit(MEM_ERROR);
+		}
+
+		strcpy(path, resolved);
+	}
+
+	return path;
+}
+
+static bool parseDocument(const char * path, const char * text, size_t length)
+{
+	bool parsed;
+
+	diagnosticPath = NULL;
+	sourceFileName = (char *)path;
+	loadSourceText(text, length);
+
+	parsed = reparseClass();
+
+	freeSource();
+	sourceFileName = NULL;
+
+	return parsed;
+}
+
+static bool finaliseWorkspace(const char * path)
+{
+	jmp_buf recovery;
+	bool volatile finalised = true;
+
+	/* Every class is finalised again since replacing a class leaves the types referring to it stale */
+
+	errorRecovery = &recovery;
+	diagnosticPath = path ? path : "";
+
+	for(classSymbolTable * volatile curClass = classes.firstClass; curClass; curClass = curClass->nextClass) {
+		if(!setjmp(recovery))
+			finaliseClass(curClass);
+		else if(path && curClass->fileName && !strcmp(curClass->fileName, path))
+			finalised = false;
+	}
+
+	errorRecovery = NULL;
+
+	return finalised;
+}
+
+void loadWorkspace(const char * path)
+{
+	struct stat status;
+	DIR * directory;
+	struct dirent * entry;
+	char resolved[PATH_MAX];
+	FILE * file;
+
+	if(stat(path, &status))
+		return;
+
+	if(S_ISDIR(status.st_mode)) {
+		if(!(directory = opendir(path)))
+			return;
+
+		while((entry = readdir(directory))) {
+			size_t nameLength = strlen(entry->d_name);
+			char * name;
+
+			if(nameLength < 6 || strcmp(entry->d_name + nameLength - 5, ".jack"))
+				continue;
+
+			if(!(name = calloc(strlen(path) + nameLength + 2, 1))) {
+				fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+				exit(MEM_ERROR);
+			}
+
+			sprintf(name, "%s/%s", path, entry->d_name);
+			loadWorkspace(name);
+			free(name);
+		}
+
+		closedir(directory);
+
+		return;
+	}
+
+	if(!realpath(path, resolved) || lookupClassFile(resolved) || !(file = fopen(resolved, "r")))
+		return;
+
+	diagnosticPath = NULL;
+	sourceFileName = resolved;
+	loadSource(file);
+	reparseClass();
+	freeSource();
+	fclose(file);
+	sourceFileName = NULL;
+
+	return;
+}
+
+void checkDocument(const char * path, const char * text, size_t length)
+{
+	jmp_buf recovery;
+	classSymbolTable * curClass;
+
+	freeDiagnostics();
+
+	if(!parseDocument(path, text, length) || !finaliseWorkspace(path) || !(curClass = lookupClassFile(path)))
+		return;
+
+	/* Generating the class finds the semantic errors and warnings, the code itself goes nowhere */
+
+	errorRecovery = &recovery;
+	diagnosticPath = path;
+	curStatement = NULL;
+
+	if(setjmp(recovery))
+		abandonClass();
+	else
+		processClass(curClass);
+
+	errorRecovery = NULL;
+	currentNodePool = NULL;
+
+	return;
+}
+
+/* Functions for answering the client */
+
+static char * copyJsonValue(const char * value)
+{
+	const char * end = skipJsonValue(value);
+	char * copy;
+
+	if(!end)
+		return NULL;
+
+	if(!(copy = calloc(end - value + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for message!\n");
+		exit(MEM_ERROR);
+	}
+
+	return memcpy(copy, value, end - value);
+}
+
+static void respond(const char * id, const char * result)
+{
+	jsonBuffer body = { 0 };
+
+	appendJson(&body, "{\"jsonrpc\":\"2.0\",\"id\":%s,\"result\":%s}", id, result);
+	writeMessage(&body);
+
+	return;
+}
+
+static void processDocument(const char * uri, const char * text)
+{
+	char * path;
+
+	if(!uri || !text)
+		return;
+
+	path = uriToPath(uri);
+	checkDocument(path, text, strlen(text));
+	publishDiagnostics(uri);
+	freeDiagnostics();
+	free(path);
+
+	return;
+}
+
+bool handleMessage(const char * message)
+{
+	char * method = readJsonString(findJsonMember(message, "method"));
+	const char * idValue = findJsonMember(message, "id");
+	char * id = idValue ? copyJsonValue(idValue) : NULL;
+	bool running = true;
+
+	if(!method) { /* Responses to requests of the server, which never sends any */
+	} else if(!strcmp(method, "initialize")) {
+		char * rootUri = readJsonString(findJsonMember(message, "params.rootUri"));
+
+		if(rootUri && !classes.firstClass) { /* Without paths on the command line the workspace is the root directory of the client */
+			char * rootPath = uriToPath(rootUri);
+
+			loadWorkspace(rootPath);
+			finaliseWorkspace(NULL);
+			free(rootPath);
+		}
+
+		free(rootUri);
+		respond(id, "{\"capabilities\":{\"textDocumentSync\":1},\"serverInfo\":{\"name\":\"jcomp\"}}");
+	} else if(!strcmp(method, "textDocument/didOpen")) {
+		char * uri = readJsonString(findJsonMember(message, "params.textDocument.uri"));
+		char * text = readJsonString(findJsonMember(message, "params.textDocument.text"));
+
+		processDocument(uri, text);
+		free(uri);
+		free(text);
+	} else if(!strcmp(method, "textDocument/didChange")) {
+		char * uri = readJsonString(findJsonMember(message, "params.textDocument.uri"));
+		const char * changes = findJsonMember(message, "params.contentChanges");
+		const char * lastChange = NULL;
+		char * text = NULL;
+
+		/* Documents are synchronised in full, so only the last change matters */
+
+		if(changes && *changes == '[') {
+			for(const char * change = changes + 1; change && *(change = skipJsonSpace(change)) == '{'; change = skipJsonSpace(skipJsonValue(change)) + 1) {
+				lastChange = change;
+
+				if(*skipJsonSpace(skipJsonValue(change)) != ',')
+					break;
+			}
+		}
+
+		if(lastChange)
+			text = readJsonString(findJsonMember(lastChange, "text"));
+
+		processDocument(uri, text);
+		free(uri);
+		free(text);
+	} else if(!strcmp(method, "shutdown")) {
+		shutdownRequested = true;
+		respond(id, "null");
+	} else if(!strcmp(method, "exit")) {
+		running = false;
+	} else if(id) {
+		jsonBuffer body = { 0 };
+
+		appendJson(&body, "{\"jsonrpc\":\"2.0\",\"id\":%s,\"error\":{\"code\":-32601,\"message\":", id);
+		appendJsonString(&body, method);
+		appendJson(&body, "}}");
+		writeMessage(&body);
+	}
+
+	free(method);
+	free(id);
+
+	return running;
+}
+
+int runLanguageServer(char ** paths, int pathCount)
+{
+	char * message;
+	bool running = true;
+
+	/* Output files are never written, every diagnostic is answered to the client instead */
+
+	options.checkOnly = true;
+	options.linkFile = options.costReportFile = NULL;
+	options.sourceMap = options.emitBytecode = options.annotateLines = false;
+	diagnosticHook = collectDiagnostic;
+
+	for(int i = 0; i < pathCount; i++)
+		loadWorkspace(paths[i]);
+
+	finaliseWorkspace(NULL);
+
+	while(running && (message = readMessage())) {
+		running = handleMessage(message);
+		free(message);
+	}
+
+	diagnosticHook = NULL;
+	freeDiagnostics();
+	freeClasses();
+
+	return shutdownRequested ? EXEC_SUCCESS : FILE_ERROR; /* The protocol asks for 1 when the client exits without a shutdown request */
+}
\ No newline at end of file
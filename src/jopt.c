@@ -0,0 +1,1257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jopt.h"
+#include "../include/jparse.h"
+#include "../include/jsym.h"
+
+/* Effects of the OS entry points which are known not to touch any program state, every other OS subroutine is treated as having all effects */
+
+const osEffect osEffects[] = {	{ "Math", "abs", EFFECT_NONE },
+								{ "Math", "min", EFFECT_NONE },
+								{ "Math", "max", EFFECT_NONE },
+								{ "Math", "multiply", EFFECT_NONE },
+								{ "Math", "divide", EFFECT_MAY_NOT_RETURN },
+								{ "Math", "sqrt", EFFECT_MAY_NOT_RETURN }
+							};
+
+const char * const osClasses[] = { "Array", "Keyboard", "Math", "Memory", "Output", "Screen", "String", "Sys" };
+
+/* State of the loop currently being optimised by the loop-invariant code motion pass */
+
+classSymbolTable * licmClass = NULL;
+functionSymbolTable * licmFunction = NULL;
+nameList loopAssigned = { 0 };
+int loopEffects = EFFECT_NONE;
+hoistedExpression * loopHoisted = NULL;
+hoistedExpression * lastLoopHoisted = NULL;
+
+/* State of the function currently being analysed by the liveness pass, positions number the statements in program order */
+
+functionSymbolTable * livenessFunction = NULL;
+localLiveness * liveness = NULL;
+int livenessPosition = 0;
+int * listEnds = NULL;
+int listCount = 0;
+loopRange * loops = NULL;
+int loopCount = 0;
+
+inlinedCall * inlinedCalls = NULL;
+inlinedCall * lastInlinedCall = NULL;
+int inlinedCallCount = 0;
+
+/* Functions for measuring and inspecting expressions */
+
+unsigned int countExpressionTerms(expression * curExpression)
+{
+	unsigned int count = 0;
+
+	if(!curExpression)
+		return 0;
+
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		count += countTermSize(curExpression->terms[i]);
+
+	return count;
+}
+
+unsigned int countTermSize(term * curTerm)
+{
+	switch(curTerm->type) {
+		case expr:
+			return countExpressionTerms(curTerm->expr);
+		case unaryTerm:
+			return 1 + countTermSize(curTerm->term);
+		case arrayReference:
+			return 1 + countExpressionTerms(curTerm->indexExpression);
+		case funcCall: {
+			unsigned int count = 1;
+
+			for(unsigned int i = 0; i < curTerm->call->expressionCount; i++)
+				count += countExpressionTerms(curTerm->call->expressionList[i]);
+
+			return count;
+		}
+		default:
+			return 1;
+	}
+}
+
+unsigned int countVariableUses(expression * curExpression, char * variableName)
+{
+	unsigned int count = 0;
+
+	if(!curExpression)
+		return 0;
+
+	for(unsigned int i = 0; i < curExpression->termCount; i++) {
+		term * curTerm = curExpression->terms[i];
+
+		/* Unary terms are unwrapped here so that "-x" still counts as a use of "x" */
+
+		while(curTerm->type == unaryTerm)
+			curTerm = curTerm->term;
+
+		if(curTerm->type == reference && !strcmp(curTerm->variableName, variableName))
+			count++;
+		else if(curTerm->type == expr)
+			count += countVariableUses(curTerm->expr, variableName);
+		else if(curTerm->type == arrayReference)
+			count += !strcmp(curTerm->arrayName, variableName) + countVariableUses(curTerm->indexExpression, variableName);
+		else if(curTerm->type == funcCall)
+			for(unsigned int j = 0; j < curTerm->call->expressionCount; j++)
+				count += countVariableUses(curTerm->call->expressionList[j], variableName);
+	}
+
+	return count;
+}
+
+unsigned int expressionStackDepth(expression * curExpression)
+{
+	unsigned int depth;
+	unsigned int height = 1; /* Values the postfix has left on the stack */
+	unsigned int position = 1;
+	unsigned int nextTerm = 1;
+
+	if(!curExpression || !curExpression->termCount)
+		return 0;
+
+	/* The first pair may be swapped when that is shallower, after it every operand is pushed on top of the values the postfix has left */
+
+	depth = pairStackDepth(curExpression, termStackDepth(curExpression->terms[0]), curExpression->termCount > 1 ? termStackDepth(curExpression->terms[1]) : 0);
+
+	if(curExpression->termCount > 1) {
+		position = 3;
+		nextTerm = 2;
+	}
+
+	for(; position < curExpression->postfixLength; position++) {
+		if(curExpression->postfix[position] != POSTFIX_OPERAND) {
+			height--;
+		} else {
+			if(height + termStackDepth(curExpression->terms[nextTerm]) > depth)
+				depth = height + termStackDepth(curExpression->terms[nextTerm]);
+
+			nextTerm++;
+			height++;
+		}
+	}
+
+	return depth;
+}
+
+unsigned int pairStackDepth(expression * curExpression, unsigned int leftDepth, unsigned int rightDepth)
+{
+	unsigned int depth;
+
+	if(curExpression->termCount < 2)
+		return leftDepth;
+
+	depth = leftDepth > rightDepth + 1 ? leftDepth : rightDepth + 1;
+
+	if(canSwapOperands(curExpression) && rightDepth > leftDepth)
+		depth = rightDepth > leftDepth + 1 ? rightDepth : leftDepth + 1;
+
+	return depth;
+}
+
+unsigned int termStackDepth(term * curTerm)
+{
+	unsigned int depth = 1;
+
+	switch(curTerm->type) {
+		case constant:
+			return curTerm->constantType == stringType ? 2 : 1;
+		case expr:
+			return expressionStackDepth(curTerm->expr);
+		case unaryTerm:
+			return termStackDepth(curTerm->term);
+		case arrayReference:
+			return 1 + expressionStackDepth(curTerm->indexExpression);
+		case funcCall:
+			/* The receiver of a method call is not known here, so arguments are counted from the bottom of the frame */
+
+			for(unsigned int i = 0; i < curTerm->call->expressionCount; i++)
+				if(i + expressionStackDepth(curTerm->call->expressionList[i]) > depth)
+					depth = i + expressionStackDepth(curTerm->call->expressionList[i]);
+
+			return depth;
+		default:
+			return 1;
+	}
+}
+
+bool canSwapOperands(expression * curExpression)
+{
+	term * left;
+	term * right;
+
+	if(curExpression->termCount < 2 || !strchr("+*&|=<>", FIRST_OPERATOR(curExpression)))
+		return false;
+
+	/* Swapping changes the evaluation order, which only matters when one side may call something the other side observes */
+
+	left = curExpression->terms[0];
+	right = curExpression->terms[1];
+
+	return (left->type == constant && left->constantType != stringType) || (right->type == constant && right->constantType != stringType) || (!termHasCalls(left) && !termHasCalls(right));
+}
+
+bool expressionHasCalls(expression * curExpression)
+{
+	if(!curExpression)
+		return false;
+
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		if(termHasCalls(curExpression->terms[i]))
+			return true;
+
+	return false;
+}
+
+bool termHasCalls(term * curTerm)
+{
+	switch(curTerm->type) {
+		case funcCall:
+			return true;
+		case expr:
+			return expressionHasCalls(curTerm->expr);
+		case unaryTerm:
+			return termHasCalls(curTerm->term);
+		case arrayReference:
+			return expressionHasCalls(curTerm->indexExpression);
+		default:
+			return false;
+	}
+}
+
+bool isSimpleExpression(expression * curExpression)
+{
+	term * curTerm;
+
+	if(!curExpression || curExpression->termCount != 1)
+		return false;
+
+	curTerm = curExpression->terms[0];
+
+	return curTerm->type == reference || (curTerm->type == constant && curTerm->constantType != stringType);
+}
+
+/* Functions for deciding which subroutines can be inlined */
+
+bool isInlineCandidate(classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics)
+{
+	statement * body = curFunction->statements;
+
+	/* Only subroutines consisting of a single "return <expression>;" are inlined, constructors are never inlined since they allocate */
+
+	if(curFunction->type == constructor || !body || body->nextStatement || body->type != returnStatement || !body->returnExpression)
+		return false;
+
+	if(countExpressionTerms(body->returnExpression) > (unsigned int)options.inlineThreshold)
+		return false;
+
+	return isInlineableExpression(body->returnExpression, curClass, curFunction, allowStatics);
+}
+
+bool isInlineableExpression(expression * curExpression, classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics)
+{
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		if(!isInlineableTerm(curExpression->terms[i], curClass, curFunction, allowStatics))
+			return false;
+
+	return true;
+}
+
+bool isInlineableTerm(term * curTerm, classSymbolTable * curClass, functionSymbolTable * curFunction, bool allowStatics)
+{
+	variableSymbol * curVariable;
+
+	switch(curTerm->type) {
+		case constant:
+			/* String constants allocate and "this" would refer to the caller's object once substituted */
+			return curTerm->constantType == integerType || (curTerm->constantType == keywordType && strcmp(curTerm->constantTerm, "this"));
+		case expr:
+			return isInlineableExpression(curTerm->expr, curClass, curFunction, allowStatics);
+		case unaryTerm:
+			return isInlineableTerm(curTerm->term, curClass, curFunction, allowStatics);
+		case reference:
+			if((curVariable = lookupFunctionVariable(curFunction, curTerm->variableName)))
+				return curVariable->isArgument; /* Locals are never initialised in a single statement body */
+
+			if(!(curVariable = lookupClassVariable(curClass, curTerm->variableName)))
+				return false;
+
+			if(curVariable->type == statik) /* Static segments are private to the file of the declaring class */
+				return allowStatics;
+
+			return curFunction->type == method;
+		default:
+			/* Calls and array references are never inlined which also rules out recursion */
+			return false;
+	}
+}
+
+/* Functions for the purity analysis of subroutines */
+
+functionSymbolTable * resolveCall(functionCall * call, classSymbolTable * curClass, functionSymbolTable * curFunction, classSymbolTable ** calleeClass)
+{
+	char * dot;
+	char * prefix;
+	variableSymbol * curVariable;
+	functionSymbolTable * callee = NULL;
+
+	*calleeClass = NULL;
+
+	if(!(dot = strchr(call->actionName, '.'))) {
+		*calleeClass = curClass;
+		return lookupClassFunction(curClass, call->actionName);
+	}
+
+	if(!(prefix = calloc(dot - call->actionName + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for subroutine name!\n");
+		exit(MEM_ERROR);
+	}
+
+	memcpy(prefix, call->actionName, dot - call->actionName);
+
+	*calleeClass = lookupClass(prefix);
+
+	/* If the prefix is not a class then it must be an object, in which case the method is looked up in the class of its type */
+
+	if(!*calleeClass && ((curVariable = lookupFunctionVariable(curFunction, prefix)) || (curVariable = lookupClassVariable(curClass, prefix))))
+		*calleeClass = lookupClass(curVariable->typeName);
+
+	if(*calleeClass)
+		callee = lookupClassFunction(*calleeClass, dot + 1);
+
+	free(prefix);
+
+	return callee;
+}
+
+int functionEffects(classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	int effects = EFFECT_NONE;
+
+	if(curFunction->effectsKnown)
+		return curFunction->effects;
+
+	if(curFunction->effectsPending) /* Recursive calls are assumed to do anything */
+		return EFFECT_ALL;
+
+	curFunction->effectsPending = true;
+
+	for(statement * curStatement = curFunction->statements; curStatement; curStatement = curStatement->nextStatement)
+		effects |= statementEffects(curStatement, curClass, curFunction);
+
+	curFunction->effectsPending = false;
+	curFunction->effectsKnown = true;
+	curFunction->effects = effects;
+
+	return effects;
+}
+
+int callEffects(functionCall * call, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	int effects = EFFECT_NONE;
+	char * dot = strchr(call->actionName, '.');
+	classSymbolTable * calleeClass;
+	functionSymbolTable * callee;
+
+	for(unsigned int i = 0; i < call->expressionCount; i++)
+		effects |= expressionEffects(call->expressionList[i], curClass, curFunction);
+
+	if(!(callee = resolveCall(call, curClass, curFunction, &calleeClass)))
+		return EFFECT_ALL;
+
+	/* A method invoked through a variable may have to read a field to find its object */
+
+	if(dot && (strlen(calleeClass->name) != (size_t)(dot - call->actionName) || strncmp(call->actionName, calleeClass->name, dot - call->actionName)))
+		effects |= EFFECT_READS_STATE;
+
+	for(unsigned int i = 0; i < sizeof(osClasses) / sizeof(char *); i++) {
+		if(!strcmp(calleeClass->name, osClasses[i])) {
+			for(unsigned int j = 0; j < sizeof(osEffects) / sizeof(osEffect); j++)
+				if(!strcmp(osEffects[j].className, calleeClass->name) && !strcmp(osEffects[j].functionName, callee->name))
+					return effects | osEffects[j].effects;
+
+			return EFFECT_ALL;
+		}
+	}
+
+	return effects | functionEffects(calleeClass, callee);
+}
+
+int statementEffects(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	int effects = EFFECT_NONE;
+
+	switch(curStatement->type) {
+		case letStatement:
+			if(curStatement->indexExpression)
+				effects |= EFFECT_READS_STATE | EFFECT_WRITES_STATE | expressionEffects(curStatement->indexExpression, curClass, curFunction);
+
+			if(!lookupFunctionVariable(curFunction, curStatement->target))
+				effects |= lookupClassVariable(curClass, curStatement->target) ? EFFECT_READS_STATE | EFFECT_WRITES_STATE : EFFECT_ALL;
+
+			return effects | expressionEffects(curStatement->expression, curClass, curFunction);
+		case ifStatement:
+			effects = expressionEffects(curStatement->ifCondition, curClass, curFunction);
+
+			for(statement * cur = curStatement->ifStatements; cur; cur = cur->nextStatement)
+				effects |= statementEffects(cur, curClass, curFunction);
+
+			for(statement * cur = curStatement->elseStatements; cur; cur = cur->nextStatement)
+				effects |= statementEffects(cur, curClass, curFunction);
+
+			return effects;
+		case whileStatement:
+			effects = EFFECT_MAY_NOT_RETURN | expressionEffects(curStatement->whileCondition, curClass, curFunction);
+
+			for(statement * cur = curStatement->whileStatements; cur; cur = cur->nextStatement)
+				effects |= statementEffects(cur, curClass, curFunction);
+
+			return effects;
+		case doStatement:
+			return callEffects(curStatement->call, curClass, curFunction);
+		case returnStatement:
+			return expressionEffects(curStatement->returnExpression, curClass, curFunction);
+		default:
+			return EFFECT_ALL;
+	}
+}
+
+int expressionEffects(expression * curExpression, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	int effects = EFFECT_NONE;
+
+	if(!curExpression)
+		return EFFECT_NONE;
+
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		effects |= termEffects(curExpression->terms[i], curClass, curFunction);
+
+	/* Division by zero halts the program, so only division by a non-zero constant is guaranteed to return. The divisor is the term pushed just before the operator */
+
+	for(unsigned int i = 1, nextTerm = 1; i < curExpression->postfixLength; i++) {
+		if(curExpression->postfix[i] == POSTFIX_OPERAND) {
+			nextTerm++;
+		} else if(curExpression->postfix[i] == '/') {
+			term * divisor = curExpression->terms[nextTerm - 1];
+
+			if(divisor->type != constant || divisor->constantType != integerType || !atoi(divisor->constantTerm))
+				effects |= EFFECT_MAY_NOT_RETURN;
+		}
+	}
+
+	return effects;
+}
+
+int termEffects(term * curTerm, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	switch(curTerm->type) {
+		case constant:
+			return curTerm->constantType == stringType ? EFFECT_WRITES_STATE : EFFECT_NONE; /* String constants allocate */
+		case reference:
+			if(lookupFunctionVariable(curFunction, curTerm->variableName))
+				return EFFECT_NONE;
+
+			return lookupClassVariable(curClass, curTerm->variableName) ? EFFECT_READS_STATE : EFFECT_ALL;
+		case arrayReference:
+			if(!lookupFunctionVariable(curFunction, curTerm->arrayName) && !lookupClassVariable(curClass, curTerm->arrayName))
+				return EFFECT_ALL;
+
+			return EFFECT_READS_STATE | expressionEffects(curTerm->indexExpression, curClass, curFunction);
+		case expr:
+			return expressionEffects(curTerm->expr, curClass, curFunction);
+		case unaryTerm:
+			return termEffects(curTerm->term, curClass, curFunction);
+		case funcCall:
+			return callEffects(curTerm->call, curClass, curFunction);
+		default:
+			return EFFECT_ALL;
+	}
+}
+
+/* Functions for loop-invariant code motion */
+
+void hoistLoopInvariants(classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	licmClass = curClass;
+	licmFunction = curFunction;
+
+	hoistStatementInvariants(&curFunction->statements);
+
+	licmClass = NULL;
+	licmFunction = NULL;
+
+	return;
+}
+
+void hoistStatementInvariants(statement ** link)
+{
+	for(; *link; link = &(*link)->nextStatement) {
+		if((*link)->type == ifStatement) {
+			hoistStatementInvariants(&(*link)->ifStatements);
+			hoistStatementInvariants(&(*link)->elseStatements);
+		} else if((*link)->type == whileStatement) {
+			/* Inner loops are optimised first so that their hoisted computations can move further out */
+
+			hoistStatementInvariants(&(*link)->whileStatements);
+			hoistWhileInvariants(link);
+
+			while((*link)->type != whileStatement)
+				link = &(*link)->nextStatement;
+		}
+	}
+
+	return;
+}
+
+static void hoistBodyInvariants(statement * curStatement)
+{
+	for(; curStatement; curStatement = curStatement->nextStatement) {
+		switch(curStatement->type) {
+			case letStatement:
+				hoistExpressionInvariants(curStatement->indexExpression);
+				hoistExpressionInvariants(curStatement->expression);
+				break;
+			case ifStatement:
+				hoistExpressionInvariants(curStatement->ifCondition);
+				hoistBodyInvariants(curStatement->ifStatements);
+				hoistBodyInvariants(curStatement->elseStatements);
+				break;
+			case whileStatement:
+				hoistExpressionInvariants(curStatement->whileCondition);
+				hoistBodyInvariants(curStatement->whileStatements);
+				break;
+			case doStatement:
+				for(unsigned int i = 0; i < curStatement->call->expressionCount; i++)
+					hoistExpressionInvariants(curStatement->call->expressionList[i]);
+				break;
+			case returnStatement:
+				hoistExpressionInvariants(curStatement->returnExpression);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return;
+}
+
+void hoistWhileInvariants(statement ** link)
+{
+	statement * loop = *link;
+	hoistedExpression * nextHoisted;
+
+	loopAssigned.count = 0;
+	collectAssignedVariables(loop->whileStatements, &loopAssigned);
+	loopEffects = statementEffects(loop, licmClass, licmFunction);
+
+	hoistExpressionInvariants(loop->whileCondition);
+	hoistBodyInvariants(loop->whileStatements);
+
+	/* Each hoisted computation is assigned to its temporary just before the loop */
+
+	for(hoistedExpression * curHoisted = loopHoisted; curHoisted; curHoisted = nextHoisted) {
+		statement * curStatement = newStatement(letStatement);
+
+		nextHoisted = curHoisted->nextExpression;
+
+		curStatement->lineNum = loop->lineNum;
+		curStatement->target = curHoisted->name;
+		curStatement->expression = curHoisted->value;
+		curStatement->nextStatement = *link;
+
+		*link = curStatement;
+		link = &curStatement->nextStatement;
+
+		free(curHoisted);
+	}
+
+	loopHoisted = lastLoopHoisted = NULL;
+
+	free(loopAssigned.names);
+	loopAssigned.names = NULL;
+	loopAssigned.count = 0;
+
+	return;
+}
+
+static char * hoistValue(expression * value)
+{
+	hoistedExpression * curHoisted;
+	variableSymbol * curVariable;
+
+	for(curHoisted = loopHoisted; curHoisted; curHoisted = curHoisted->nextExpression) {
+		if(expressionsEqual(curHoisted->value, value)) /* Identical computations in the same loop share one temporary */
+			return curHoisted->name;
+	}
+
+	if(!(curHoisted = calloc(1, sizeof(hoistedExpression)))) {
+		fprintf(stderr, "Error: Could not allocate memory for hoisted expression!\n");
+		exit(MEM_ERROR);
+	}
+
+	curVariable = newTemporaryVariable(licmFunction);
+
+	curHoisted->name = copyNodeString(curVariable->name);
+	curHoisted->value = value;
+
+	if(!lastLoopHoisted) {
+		loopHoisted = lastLoopHoisted = curHoisted;
+	} else {
+		lastLoopHoisted->nextExpression = curHoisted;
+		lastLoopHoisted = curHoisted;
+	}
+
+	return curHoisted->name;
+}
+
+void hoistExpressionInvariants(expression * curExpression)
+{
+	expression * value;
+	term * temporary;
+
+	if(!curExpression)
+		return;
+
+	if(curExpression->termCount < 2 || !isLoopInvariantExpression(curExpression)) {
+		for(unsigned int i = 0; i < curExpression->termCount; i++)
+			hoistTermInvariants(curExpression->terms[i]);
+
+		return;
+	}
+
+	/* The computation is moved into a new expression and the original is left holding a reference to the temporary */
+
+	value = newExpression();
+
+	moveOperands(value, curExpression);
+
+	temporary = newTerm();
+	temporary->type = reference;
+	temporary->variableName = copyNodeString(hoistValue(value));
+
+	addTerm(curExpression, temporary);
+
+	return;
+}
+
+void hoistTermInvariants(term * curTerm)
+{
+	term * valueTerm;
+	expression * value;
+
+	switch(curTerm->type) {
+		case expr:
+			hoistExpressionInvariants(curTerm->expr);
+			return;
+		case unaryTerm:
+			hoistTermInvariants(curTerm->term);
+			return;
+		case funcCall:
+			if(!isLoopInvariantTerm(curTerm)) {
+				for(unsigned int i = 0; i < curTerm->call->expressionCount; i++)
+					hoistExpressionInvariants(curTerm->call->expressionList[i]);
+
+				return;
+			}
+
+			break;
+		case arrayReference:
+			if(!isLoopInvariantTerm(curTerm)) {
+				hoistExpressionInvariants(curTerm->indexExpression);
+				return;
+			}
+
+			break;
+		default:
+			return;
+	}
+
+	/* Calls and array reads are moved into a term of their own and the original term becomes a reference */
+
+	valueTerm = newTerm();
+	memcpy(valueTerm, curTerm, sizeof(term));
+
+	value = newExpression();
+	addTerm(value, valueTerm);
+
+	memset(curTerm, 0, sizeof(term));
+	curTerm->type = reference;
+	curTerm->variableName = copyNodeString(hoistValue(value));
+
+	return;
+}
+
+bool isLoopInvariantExpression(expression * curExpression)
+{
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		if(!isLoopInvariantTerm(curExpression->terms[i]))
+			return false;
+
+	return !(expressionEffects(curExpression, licmClass, licmFunction) & EFFECT_MAY_NOT_RETURN);
+}
+
+static bool isAssignedInLoop(char * name)
+{
+	for(unsigned int i = 0; i < loopAssigned.count; i++)
+		if(!strcmp(loopAssigned.names[i], name))
+			return true;
+
+	return false;
+}
+
+static bool isLoopInvariantVariable(char * name)
+{
+	if(isAssignedInLoop(name))
+		return false;
+
+	if(lookupFunctionVariable(licmFunction, name))
+		return true;
+
+	/* Fields and statics may also be changed by anything the loop calls */
+
+	return lookupClassVariable(licmClass, name) && !(loopEffects & EFFECT_WRITES_STATE);
+}
+
+bool isLoopInvariantTerm(term * curTerm)
+{
+	int effects;
+	char * dot;
+
+	switch(curTerm->type) {
+		case constant:
+			return curTerm->constantType != stringType;
+		case reference:
+			return isLoopInvariantVariable(curTerm->variableName);
+		case arrayReference:
+			return !(loopEffects & EFFECT_WRITES_STATE) && isLoopInvariantVariable(curTerm->arrayName) && isLoopInvariantExpression(curTerm->indexExpression);
+		case expr:
+			return isLoopInvariantExpression(curTerm->expr);
+		case unaryTerm:
+			return isLoopInvariantTerm(curTerm->term);
+		case funcCall:
+			effects = callEffects(curTerm->call, licmClass, licmFunction);
+
+			if((effects & (EFFECT_WRITES_STATE | EFFECT_MAY_NOT_RETURN)) || ((effects & EFFECT_READS_STATE) && (loopEffects & EFFECT_WRITES_STATE)))
+				return false;
+
+			if((dot = strchr(curTerm->call->actionName, '.'))) {
+				bool invariant;
+
+				*dot = '\0';
+				invariant = !lookupFunctionVariable(licmFunction, curTerm->call->actionName) || isLoopInvariantVariable(curTerm->call->actionName);
+				*dot = '.';
+
+				if(!invariant)
+					return false;
+			}
+
+			for(unsigned int i = 0; i < curTerm->call->expressionCount; i++)
+				if(!isLoopInvariantExpression(curTerm->call->expressionList[i]))
+					return false;
+
+			return true;
+		default:
+			return false;
+	}
+}
+
+void collectAssignedVariables(statement * curStatement, nameList * assigned)
+{
+	for(; curStatement; curStatement = curStatement->nextStatement) {
+		switch(curStatement->type) {
+			case letStatement:
+				if(curStatement->indexExpression)
+					break;
+
+				if(!(assigned->names = realloc(assigned->names, (assigned->count + 1) * sizeof(char *)))) {
+					fprintf(stderr, "Error: Could not allocate memory for variable list!\n");
+					exit(MEM_ERROR);
+				}
+
+				assigned->names[assigned->count++] = curStatement->target;
+				break;
+			case ifStatement:
+				collectAssignedVariables(curStatement->ifStatements, assigned);
+				collectAssignedVariables(curStatement->elseStatements, assigned);
+				break;
+			case whileStatement:
+				collectAssignedVariables(curStatement->whileStatements, assigned);
+				break;
+			default:
+				break;
+		}
+	}
+
+	return;
+}
+
+bool expressionsEqual(expression * first, expression * second)
+{
+	if(!first || !second)
+		return first == second;
+
+	if(first->termCount != second->termCount || first->postfixLength != second->postfixLength)
+		return false;
+
+	if(memcmp(first->postfix, second->postfix, first->postfixLength))
+		return false;
+
+	for(unsigned int i = 0; i < first->termCount; i++)
+		if(!termsEqual(first->terms[i], second->terms[i]))
+			return false;
+
+	return true;
+}
+
+bool termsEqual(term * first, term * second)
+{
+	if(first->type != second->type)
+		return false;
+
+	switch(first->type) {
+		case constant:
+			return first->constantType == second->constantType && !strcmp(first->constantTerm, second->constantTerm);
+		case reference:
+			return !strcmp(first->variableName, second->variableName);
+		case arrayReference:
+			return !strcmp(first->arrayName, second->arrayName) && expressionsEqual(first->indexExpression, second->indexExpression);
+		case expr:
+			return expressionsEqual(first->expr, second->expr);
+		case unaryTerm:
+			return first->operator == second->operator && termsEqual(first->term, second->term);
+		case funcCall:
+			if(strcmp(first->call->actionName, second->call->actionName) || first->call->expressionCount != second->call->expressionCount)
+				return false;
+
+			for(unsigned int i = 0; i < first->call->expressionCount; i++)
+				if(!expressionsEqual(first->call->expressionList[i], second->call->expressionList[i]))
+					return false;
+
+			return true;
+		default:
+			return false;
+	}
+}
+
+variableSymbol * newTemporaryVariable(functionSymbolTable * curFunction)
+{
+	char name[32];
+	variableSymbol * curVariable = newVariableSymbol();
+
+	/* "$" cannot appear in a Jack identifier so temporaries never clash with declared variables */
+
+	snprintf(name, sizeof(name), "$temp%d", curFunction->variableCount);
+
+	setVariableName(curVariable, name);
+	setVariableTypeName(curVariable, "int");
+	addVariableToFunction(curFunction, curVariable);
+
+	curVariable->type = variable;
+	curVariable->construction = primitive;
+	curVariable->isTemporary = true;
+	curVariable->lineNum = curFunction->lineNum;
+
+	return curVariable;
+}
+
+/* Functions for the liveness analysis of local variables */
+
+void analyseLiveness(functionSymbolTable * curFunction)
+{
+	localLiveness * curLiveness;
+
+	livenessFunction = curFunction;
+	livenessPosition = 0;
+
+	if(!(liveness = calloc(curFunction->variableCount + 1, sizeof(localLiveness)))) {
+		fprintf(stderr, "Error: Could not allocate memory for liveness analysis!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(int i = 0; i < curFunction->variableCount; i++)
+		liveness[i].firstPosition = liveness[i].definitionList = -1;
+
+	analyseStatementList(curFunction->statements);
+
+	/* A variable is only independent of its initial value if it is assigned before every read, which holds when the
+	 * first reference assigns it and every other reference follows that assignment in the same statement list */
+
+	for(variableSymbol * curVariable = curFunction->variables; curVariable; curVariable = curVariable->nextVariable) {
+		curLiveness = &liveness[curVariable->offset];
+
+		if(curLiveness->firstPosition < 0)
+			curVariable->definedBeforeUse = true; /* Never read at all */
+		else
+			curVariable->definedBeforeUse = curLiveness->definitionList >= 0 && curLiveness->lastPosition <= listEnds[curLiveness->definitionList];
+	}
+
+	return;
+}
+
+int analyseStatementList(statement * curStatement)
+{
+	int list = listCount++;
+
+	if(!(listEnds = realloc(listEnds, listCount * sizeof(int)))) {
+		fprintf(stderr, "Error: Could not allocate memory for liveness analysis!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(; curStatement; curStatement = curStatement->nextStatement)
+		analyseStatement(curStatement, list);
+
+	listEnds[list] = livenessPosition - 1;
+
+	return list;
+}
+
+void analyseStatement(statement * curStatement, int list)
+{
+	int position = livenessPosition++;
+
+	switch(curStatement->type) {
+		case letStatement:
+			analyseExpression(curStatement->indexExpression, position);
+			analyseExpression(curStatement->expression, position);
+
+			/* Storing into an array element reads the array variable rather than assigning it */
+
+			recordReference(curStatement->target, position, list, !curStatement->indexExpression);
+			break;
+		case ifStatement:
+			analyseExpression(curStatement->ifCondition, position);
+			analyseStatementList(curStatement->ifStatements);
+			analyseStatementList(curStatement->elseStatements);
+			break;
+		case whileStatement:
+			analyseExpression(curStatement->whileCondition, position);
+			analyseStatementList(curStatement->whileStatements);
+
+			if(!(loops = realloc(loops, (loopCount + 1) * sizeof(loopRange)))) {
+				fprintf(stderr, "Error: Could not allocate memory for liveness analysis!\n");
+				exit(MEM_ERROR);
+			}
+
+			loops[loopCount].start = position;
+			loops[loopCount++].end = livenessPosition - 1;
+			break;
+		case doStatement:
+			for(unsigned int i = 0; i < curStatement->call->expressionCount; i++)
+				analyseExpression(curStatement->call->expressionList[i], position);
+
+			if(strchr(curStatement->call->actionName, '.')) {
+				char * dot = strchr(curStatement->call->actionName, '.');
+
+				*dot = '\0';
+				recordReference(curStatement->call->actionName, position, list, false);
+				*dot = '.';
+			}
+
+			break;
+		case returnStatement:
+			analyseExpression(curStatement->returnExpression, position);
+			break;
+		default:
+			break;
+	}
+
+	return;
+}
+
+void analyseExpression(expression * curExpression, int position)
+{
+	if(!curExpression)
+		return;
+
+	for(unsigned int i = 0; i < curExpression->termCount; i++)
+		analyseTerm(curExpression->terms[i], position);
+
+	return;
+}
+
+void analyseTerm(term * curTerm, int position)
+{
+	char * dot;
+
+	switch(curTerm->type) {
+		case reference:
+			recordReference(curTerm->variableName, position, -1, false);
+			break;
+		case arrayReference:
+			recordReference(curTerm->arrayName, position, -1, false);
+			analyseExpression(curTerm->indexExpression, position);
+			break;
+		case expr:
+			analyseExpression(curTerm->expr, position);
+			break;
+		case unaryTerm:
+			analyseTerm(curTerm->term, position);
+			break;
+		case funcCall:
+			for(unsigned int i = 0; i < curTerm->call->expressionCount; i++)
+				analyseExpression(curTerm->call->expressionList[i], position);
+
+			if((dot = strchr(curTerm->call->actionName, '.'))) { /* The object a method is invoked on is read as well */
+				*dot = '\0';
+				recordReference(curTerm->call->actionName, position, -1, false);
+				*dot = '.';
+			}
+
+			break;
+		default:
+			break;
+	}
+
+	return;
+}
+
+void recordReference(char * variableName, int position, int list, bool isDefinition)
+{
+	localLiveness * curLiveness;
+	variableSymbol * curVariable;
+
+	if(!(curVariable = lookupFunctionVariable(livenessFunction, variableName)) || curVariable->isArgument)
+		return;
+
+	curLiveness = &liveness[curVariable->offset];
+
+	if(curLiveness->firstPosition < 0) {
+		curLiveness->firstPosition = position;
+		curLiveness->definitionList = isDefinition ? list : -1;
+	}
+
+	if(!(curLiveness->positions = realloc(curLiveness->positions, (curLiveness->positionCount + 1) * sizeof(int)))) {
+		fprintf(stderr, "Error: Could not allocate memory for liveness analysis!\n");
+		exit(MEM_ERROR);
+	}
+
+	curLiveness->positions[curLiveness->positionCount++] = position;
+	curLiveness->lastPosition = position;
+
+	return;
+}
+
+int packLocalVariables(functionSymbolTable * curFunction)
+{
+	int slotCount = 0;
+	int pinnedCount;
+	int * slotEnds;
+	int * intervalEnds;
+	variableSymbol ** order;
+	unsigned int orderCount = 0;
+
+	analyseLiveness(curFunction);
+
+	if(!(slotEnds = calloc(curFunction->variableCount + 1, sizeof(int))) || !(intervalEnds = calloc(curFunction->variableCount + 1, sizeof(int))) || !(order = calloc(curFunction->variableCount + 1, sizeof(variableSymbol *)))) {
+		fprintf(stderr, "Error: Could not allocate memory for liveness analysis!\n");
+		exit(MEM_ERROR);
+	}
+
+	/* Variables which may be read before being assigned depend on the VM zeroing their slot, so they keep a slot of their own */
+
+	for(variableSymbol * curVariable = curFunction->variables; curVariable; curVariable = curVariable->nextVariable) {
+		localLiveness * curLiveness = &liveness[curVariable->offset];
+
+		if(curLiveness->firstPosition < 0)
+			continue;
+
+		if(!curVariable->definedBeforeUse) {
+			intervalEnds[curVariable->offset] = -1;
+			curVariable->offset = slotCount++;
+			continue;
+		}
+
+		/* A value which is live on entry to a loop stays live for the whole loop since it is needed again on the next iteration */
+
+		intervalEnds[curVariable->offset] = curLiveness->lastPosition;
+
+		for(int i = 0; i < loopCount; i++) {
+			if(loops[i].start <= curLiveness->firstPosition)
+				continue;
+
+			for(unsigned int j = 0; j < curLiveness->positionCount; j++) {
+				if(curLiveness->positions[j] >= loops[i].start && curLiveness->positions[j] <= loops[i].end) {
+					if(loops[i].end > intervalEnds[curVariable->offset])
+						intervalEnds[curVariable->offset] = loops[i].end;
+
+					break;
+				}
+			}
+		}
+
+		/* Insert into the list of packable variables ordered by the start of their lifetime */
+
+		unsigned int i = orderCount++;
+
+		for(; i > 0 && liveness[order[i - 1]->offset].firstPosition > curLiveness->firstPosition; i--)
+			order[i] = order[i - 1];
+
+		order[i] = curVariable;
+	}
+
+	/* Greedily place each variable in the first slot whose previous occupant is dead by the time it is assigned */
+
+	pinnedCount = slotCount;
+
+	for(unsigned int i = 0; i < orderCount; i++) {
+		int slot;
+		localLiveness * curLiveness = &liveness[order[i]->offset];
+		int intervalEnd = intervalEnds[order[i]->offset];
+
+		for(slot = pinnedCount; slot < slotCount && slotEnds[slot] >= curLiveness->firstPosition; slot++)
+			;
+
+		if(slot == slotCount)
+			slotCount++;
+
+		slotEnds[slot] = intervalEnd;
+		order[i]->offset = slot;
+	}
+
+	free(order);
+	free(intervalEnds);
+	free(slotEnds);
+	freeLiveness();
+
+	return slotCount;
+}
+
+void freeLiveness()
+{
+	for(int i = 0; livenessFunction && i < livenessFunction->variableCount; i++)
+		free(liveness[i].positions);
+
+	free(liveness);
+	free(listEnds);
+	free(loops);
+
+	liveness = NULL;
+	listEnds = NULL;
+	loops = NULL;
+	listCount = 0;
+	loopCount = 0;
+	livenessFunction = NULL;
+
+	return;
+}
+
+/* Functions for tail call elimination */
+
+bool isSelfTailCall(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	term * curTerm;
+	classSymbolTable * calleeClass;
+	char * dot;
+
+	if(curStatement->type != returnStatement || !curStatement->returnExpression || curStatement->returnExpression->termCount != 1)
+		return false;
+
+	curTerm = curStatement->returnExpression->terms[0];
+
+	if(curTerm->type != funcCall || curFunction->type == constructor)
+		return false;
+
+	if(resolveCall(curTerm->call, curClass, curFunction, &calleeClass) != curFunction || calleeClass != curClass)
+		return false;
+
+	/* A method may only jump back to its own entry when it is invoked on the same object */
+
+	if((dot = strchr(curTerm->call->actionName, '.')) && curFunction->type == method)
+		return false;
+
+	return curTerm->call->expressionCount == (unsigned int)(curFunction->argumentCount - (curFunction->type == method));
+}
+
+bool hasSelfTailCall(statement * curStatement, classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	for(; curStatement; curStatement = curStatement->nextStatement) {
+		if(isSelfTailCall(curStatement, curClass, curFunction))
+			return true;
+
+		if(curStatement->type == ifStatement && (hasSelfTailCall(curStatement->ifStatements, curClass, curFunction) || hasSelfTailCall(curStatement->elseStatements, curClass, curFunction)))
+			return true;
+
+		if(curStatement->type == whileStatement && hasSelfTailCall(curStatement->whileStatements, curClass, curFunction))
+			return true;
+	}
+
+	return false;
+}
+
+/* Functions for reporting inlined call sites */
+
+static char * qualifiedName(classSymbolTable * curClass, functionSymbolTable * curFunction)
+{
+	char * name;
+	size_t length = strlen(curClass->name) + strlen(curFunction->name) + 2;
+
+	if(!(name = malloc(length))) {
+		fprintf(stderr, "Error: Could not allocate memory for function name!\n");
+		exit(MEM_ERROR);
+	}
+
+	snprintf(name, length, "%s.%s", curClass->name, curFunction->name);
+
+	return name;
+}
+
+void recordInlinedCall(classSymbolTable * callerClass, functionSymbolTable * caller, classSymbolTable * calleeClass, functionSymbolTable * callee, int lineNum)
+{
+	inlinedCall * curCall;
+
+	if(!(curCall = calloc(1, sizeof(inlinedCall)))) {
+		fprintf(stderr, "Error: Could not allocate memory for inlining report!\n");
+		exit(MEM_ERROR);
+	}
+
+	curCall->caller = qualifiedName(callerClass, caller);
+	curCall->callee = qualifiedName(calleeClass, callee);
+	curCall->lineNum = lineNum;
+
+	if(!lastInlinedCall) {
+		inlinedCalls = lastInlinedCall = curCall;
+	} else {
+		lastInlinedCall->nextCall = curCall;
+		lastInlinedCall = curCall;
+	}
+
+	inlinedCallCount++;
+
+	return;
+}
+
+void printInlineReport()
+{
+	printf("[+] Inlined %d call site%s\n", inlinedCallCount, inlinedCallCount == 1 ? "" : "s");
+
+	for(inlinedCall * curCall = inlinedCalls; curCall; curCall = curCall->nextCall)
+		printf("[-] %s (line %d): %s\n", curCall->caller, curCall->lineNum, curCall->callee);
+
+	return;
+}
+
+void freeInlineReport()
+{
+	inlinedCall * nextCall;
+
+	for(inlinedCall * curCall = inlinedCalls; curCall; curCall = nextCall) {
+		nextCall = curCall->nextCall;
+
+		free(curCall->caller);
+		free(curCall->callee);
+		free(curCall);
+	}
+
+	inlinedCalls = lastInlinedCall = NULL;
+	inlinedCallCount = 0;
+
+	return;
+}
\ No newline at end of file
@@ -16,16 +16,48 @@ extern term * curTerm;
 
 extern FILE * sourceFile;
 
+unsigned long parseNodeCount = 0; /* Statements, expressions and terms created so far, for measuring parser throughput */
+nodePool * currentNodePool = NULL; /* Pool of the subroutine being parsed or generated */
+
 void syntaxError(char * expected, token currToken)
 {
+	if(diagnosticHook) {
+		char message[MAX_LEXEME_SIZE + 128];
+
+		if(currToken.type == keyword || currToken.type == integer || currToken.type == identifier || currToken.type == string)
+			snprintf(message, sizeof(message), "%s expected! Got \"%s\" instead", expected, currToken.string);
+		else if(currToken.type == terminator)
+			snprintf(message, sizeof(message), "%s expected! Got the end of the file instead", expected);
+		else
+			snprintf(message, sizeof(message), "%s expected! Got \"%c\" instead", expected, currToken.character);
+
+		syntaxOkay(currToken); /* The parser never gets the token back to free it */
+		raiseDiagnostic(severityError, message, currToken.lineNum);
+	}
+
 	if(currToken.type == keyword || currToken.type == integer || currToken.type == identifier || currToken.type == string)
 		fprintf(stderr, "\nSyntax error: %s expected! Got \"%s\" instead (line %d)\n", expected, currToken.string, currToken.lineNum);
+	else if(currToken.type == terminator)
+		fprintf(stderr, "\nSyntax error: %s expected! Got the end of the file instead (line %d)\n", expected, currToken.lineNum);
 	else
 		fprintf(stderr, "\nSyntax error: %s expected! Got \"%c\" instead (line %d)\n", expected, currToken.character, currToken.lineNum);
 
+	/* Recovery skips ahead from the offending token, there is nothing left to skip to at the end of the file */
+
+	if(countError(PARSE_ERROR) && errorRecovery && currToken.type != terminator) {
+		ungetToken(&currToken);
+		longjmp(*errorRecovery, 1);
+	}
+
 	freeClasses();
+	freeSource();
 	fclose(sourceFile);
-	exit(PARSE_ERROR);
+	exit(errorStatus);
+}
+
+bool isKeywordToken(token currToken, const char * word)
+{
+	return currToken.type == keyword && !strcmp(currToken.string, word); /* Other tokens may not hold a string at all */
 }
 
 /*void syntaxOkay(token currToken)
@@ -61,17 +93,89 @@ void syntaxOkay(token currToken)
 	return;
 }
 
-/* Statement functions */
+/* Node pool functions */
 
-statement * newStatement(statementType newStatementType)
+nodePool * newNodePool()
 {
-	statement * newStatement;
+	nodePool * pool;
 
-	if(!(newStatement = calloc(sizeof(statement), 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for new statement!\n");
+	if(!(pool = calloc(1, sizeof(nodePool)))) {
+		fprintf(stderr, "Error: Could not allocate memory for node pool!\n");
 		exit(MEM_ERROR);
 	}
 
+	return pool;
+}
+
+void * allocateNode(size_t size)
+{
+	nodeBlock * block;
+	void * node;
+
+	if(!currentNodePool) {
+		fprintf(stderr, "Error: Parse tree node created outside of a subroutine!\n");
+		exit(MEM_ERROR);
+	}
+
+	size = (size + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+	block = currentNodePool->blocks;
+
+	/* Blocks are calloc'd, so nodes start out zeroed like the individually allocated nodes they replace */
+
+	if(!block || block->used + size > block->size) {
+		size_t blockSize = size > NODE_BLOCK_SIZE ? size : NODE_BLOCK_SIZE;
+
+		if(!(block = calloc(1, sizeof(nodeBlock) + blockSize))) {
+			fprintf(stderr, "Error: Could not allocate memory for node pool!\n");
+			exit(MEM_ERROR);
+		}
+
+		block->size = blockSize;
+		block->nextBlock = currentNodePool->blocks;
+		currentNodePool->blocks = block;
+	}
+
+	node = (char *)block->storage + block->used;
+	block->used += size;
+
+	return node;
+}
+
+char * copyNodeString(const char * string)
+{
+	size_t length = strlen(string);
+
+	return memcpy(allocateNode(length + 1), string, length + 1);
+}
+
+void freeNodePool(nodePool * pool)
+{
+	nodeBlock * nextBlock;
+
+	if(!pool)
+		return;
+
+	for(nodeBlock * block = pool->blocks; block; block = nextBlock) {
+		nextBlock = block->nextBlock;
+		free(block);
+	}
+
+	if(currentNodePool == pool)
+		currentNodePool = NULL;
+
+	free(pool);
+
+	return;
+}
+
+/* Statement functions */
+
+statement * newStatement(statementType newStatementType)
+{
+	statement * newStatement;
+
+	newStatement = allocateNode(sizeof(statement));
+	parseNodeCount++;
 	newStatement->type = newStatementType;
 
 	return newStatement;
@@ -83,150 +187,105 @@ expression * newExpression()
 {
 	expression * newExpr;
 
-	if(!(newExpr = calloc(sizeof(expression), 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for new expression!\n");
-		exit(MEM_ERROR);
-	}
+	newExpr = allocateNode(sizeof(expression));
+	newExpr->terms = newExpr->termStorage;
+	newExpr->postfix = newExpr->postfixStorage;
+	newExpr->termCapacity = INLINE_OPERANDS;
+	parseNodeCount++;
 
 	return newExpr;
 }
 
+static void growOperands(expression * curExpression)
+{
+	unsigned int capacity = curExpression->termCapacity * 2;
+	term ** terms = allocateNode(capacity * sizeof(term *));
+	char * postfix = allocateNode(2 * capacity);
+
+	/* The outgrown lists stay behind in the pool until the whole pool is released */
+
+	memcpy(terms, curExpression->terms, curExpression->termCount * sizeof(term *));
+	memcpy(postfix, curExpression->postfix, curExpression->postfixLength);
+
+	curExpression->terms = terms;
+	curExpression->postfix = postfix;
+	curExpression->termCapacity = capacity;
+
+	return;
+}
+
 void addOperator(expression * curExpression, char operator)
 {
-	if(!(curExpression->operators = realloc(curExpression->operators, curExpression->operatorCount + 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for operator list!\n");
-		exit(MEM_ERROR);
-	}
+	/* Applies to the two values on top of the postfix, so it is added after its right operand */
 
-	curExpression->operators[curExpression->operatorCount++] = operator;
+	curExpression->postfix[curExpression->postfixLength++] = operator;
 }
 
 void addTerm(expression * curExpression, term * curTerm)
 {
-	if(!(curExpression->terms = realloc(curExpression->terms, (curExpression->termCount + 1) * sizeof(term *)))) {
-		fprintf(stderr, "Error: Could not allocate memory for term list!\n");
-		exit(MEM_ERROR);
-	}
+	if(curExpression->termCount == curExpression->termCapacity)
+		growOperands(curExpression);
 
 	curExpression->terms[curExpression->termCount++] = curTerm;
+	curExpression->postfix[curExpression->postfixLength++] = POSTFIX_OPERAND;
 }
 
-/* Term functions */
-
-term * newTerm()
+void moveOperands(expression * destination, expression * source)
 {
-	term * newTerm;
+	/* Lists already moved out into the pool change owner, lists still inside the source node are copied into the destination node */
 
-	if(!(newTerm = calloc(sizeof(term), 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for new term!\n");
-		exit(MEM_ERROR);
+	if(source->terms == source->termStorage) {
+		memcpy(destination->termStorage, source->termStorage, sizeof(source->termStorage));
+		memcpy(destination->postfixStorage, source->postfixStorage, sizeof(source->postfixStorage));
+		destination->terms = destination->termStorage;
+		destination->postfix = destination->postfixStorage;
+	} else {
+		destination->terms = source->terms;
+		destination->postfix = source->postfix;
 	}
 
-	return newTerm;
-}
+	destination->termCount = source->termCount;
+	destination->postfixLength = source->postfixLength;
+	destination->termCapacity = source->termCapacity;
 
-void addConst(term * curTerm, char * constant)
-{
-	if(!(curTerm->constantTerm = calloc(strlen(constant) + 1, 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for constant term!\n");
-		exit(MEM_ERROR);
-	}
+	source->terms = source->termStorage;
+	source->postfix = source->postfixStorage;
+	source->termCount = source->postfixLength = 0;
+	source->termCapacity = INLINE_OPERANDS;
 
-	strncpy(curTerm->constantTerm, constant, strlen(constant));
+	return;
 }
 
-/* Cleanup functions */
-
-void freeStatement(statement * currentStatement)
+void addArgument(functionCall * call, expression * argument)
 {
-	if(!currentStatement)
-		return;
+	if(!call->expressionList) {
+		call->expressionList = call->argumentStorage;
+		call->argumentCapacity = INLINE_ARGUMENTS;
+	} else if(call->expressionCount == call->argumentCapacity) {
+		expression ** arguments = allocateNode(call->argumentCapacity * 2 * sizeof(expression *));
+
+		memcpy(arguments, call->expressionList, call->expressionCount * sizeof(expression *));
 
-	switch(currentStatement->type) {
-		case ifStatement:
-			freeExpression(currentStatement->ifCondition);
-			freeStatement(currentStatement->ifStatements);
-			freeStatement(currentStatement->elseStatements);
-			break;
-		case letStatement:
-			free(currentStatement->target);
-			freeExpression(currentStatement->indexExpression);
-			freeExpression(currentStatement->expression);
-			break;
-		case whileStatement:
-			freeExpression(currentStatement->whileCondition);
-			freeStatement(currentStatement->whileStatements);
-			break; 
-		case returnStatement:
-			freeExpression(currentStatement->returnExpression);
-			break;
-		case doStatement:
-			free(currentStatement->call->actionName);
-
-			while(currentStatement->call->expressionCount)
-				freeExpression(currentStatement->call->expressionList[--currentStatement->call->expressionCount]);
-
-			free(currentStatement->call->expressionList);
-
-			free(currentStatement->call);
-			break;
-		case varStatement:
-			break;
-		default:
-			break;
+		call->expressionList = arguments;
+		call->argumentCapacity *= 2;
 	}
 
-	freeStatement(currentStatement->nextStatement);
-	free(currentStatement);
+	call->expressionList[call->expressionCount++] = argument;
 }
 
-void freeExpression(expression * currentExpression)
+/* Term functions */
+
+term * newTerm()
 {
-	if(!currentExpression)
-		return;
+	term * newTerm;
 
-	while(currentExpression->termCount)
-		freeTerm(currentExpression->terms[--currentExpression->termCount]);
+	newTerm = allocateNode(sizeof(term));
+	parseNodeCount++;
 
-	free(currentExpression->terms);
-	free(currentExpression->operators);
-	free(currentExpression);
+	return newTerm;
 }
 
-void freeTerm(term * currentTerm)
+void addConst(term * curTerm, char * constant)
 {
-	if(!currentTerm)
-		return;
-
-	switch(currentTerm->type) {
-		case constant:
-			free(currentTerm->constantTerm);
-			break;
-		case reference:
-			free(currentTerm->variableName);
-			break;
-		case unaryTerm:
-			freeTerm(currentTerm->term);
-			break;
-		case expr:
-			freeExpression(currentTerm->expr);
-			break;
-		case arrayReference:
-			free(currentTerm->arrayName);
-			freeExpression(currentTerm->indexExpression);
-			break;
-		case funcCall:
-			free(currentTerm->call->actionName);
-
-			while(currentTerm->call->expressionCount)
-				freeExpression(currentTerm->call->expressionList[--currentTerm->call->expressionCount]);
-
-			free(currentTerm->call->expressionList);
-			free(currentTerm->call);
-			break;
-		default:
-			break;
-	}
-
-	free(currentTerm);
+	curTerm->constantTerm = copyNodeString(constant);
 }
@@ -0,0 +1,205 @@
+#include <ctype.h>
+#include <string.h>
+
+#include "../include/jscan.h"
+
+/* Block scanners are only built for x86 with GCC or Clang, defining JSCAN_SCALAR forces the portable scanner */
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(JSCAN_SCALAR)
+#define JSCAN_BLOCKS
+#include <immintrin.h>
+#endif
+
+static size_t scalarSkipWhitespace(const char * buffer, size_t position, size_t length, int * lines)
+{
+	for(; position < length && isspace((unsigned char)buffer[position]); position++)
+		if(buffer[position] == '\n')
+			(*lines)++;
+
+	return position;
+}
+
+static size_t scalarFindLineEnd(const char * buffer, size_t position, size_t length)
+{
+	const char * end = memchr(buffer + position, '\n', length - position);
+
+	return end ? (size_t)(end - buffer) : length;
+}
+
+static size_t scalarFindCommentEnd(const char * buffer, size_t position, size_t length, int * lines)
+{
+	for(; position < length; position++) {
+		if(buffer[position] == '*' && buffer[position + 1] == '/')
+			return position + 2;
+
+		if(buffer[position] == '\n')
+			(*lines)++;
+	}
+
+	return length;
+}
+
+static const sourceScanner scalarScanner = { "scalar", scalarSkipWhitespace, scalarFindLineEnd, scalarFindCommentEnd };
+
+#ifdef JSCAN_BLOCKS
+
+/* Whitespace is a space or one of the control characters from tab to carriage return, the padding after the source never is */
+
+__attribute__((target("sse2"))) static size_t sse2SkipWhitespace(const char * buffer, size_t position, size_t length, int * lines)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i controlRange = _mm_set1_epi8('\r' - '\t');
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	for(; position < length; position += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(buffer + position));
+		__m128i control = _mm_sub_epi8(block, tab);
+		__m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(_mm_min_epu8(control, controlRange), control));
+		unsigned int newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+		unsigned int others = ~_mm_movemask_epi8(blank) & 0xFFFF;
+
+		if(others) {
+			unsigned int first = __builtin_ctz(others);
+
+			*lines += __builtin_popcount(newlines & ((1u << first) - 1));
+
+			return position + first < length ? position + first : length;
+		}
+
+		*lines += __builtin_popcount(newlines);
+	}
+
+	return length;
+}
+
+__attribute__((target("sse2"))) static size_t sse2FindLineEnd(const char * buffer, size_t position, size_t length)
+{
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	for(; position < length; position += 16) {
+		unsigned int newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(buffer + position)), newline));
+
+		if(newlines)
+			return position + __builtin_ctz(newlines) < length ? position + __builtin_ctz(newlines) : length;
+	}
+
+	return length;
+}
+
+__attribute__((target("sse2"))) static size_t sse2FindCommentEnd(const char * buffer, size_t position, size_t length, int * lines)
+{
+	const __m128i star = _mm_set1_epi8('*');
+	const __m128i slash = _mm_set1_epi8('/');
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	/* The block one character further on lines every star up with the character following it */
+
+	for(; position < length; position += 16) {
+		__m128i block = _mm_loadu_si128((const __m128i *)(buffer + position));
+		__m128i next = _mm_loadu_si128((const __m128i *)(buffer + position + 1));
+		unsigned int ends = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block, star), _mm_cmpeq_epi8(next, slash)));
+		unsigned int newlines = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+		if(ends) {
+			unsigned int first = __builtin_ctz(ends);
+
+			*lines += __builtin_popcount(newlines & ((1u << first) - 1));
+
+			return position + first + 2;
+		}
+
+		*lines += __builtin_popcount(newlines);
+	}
+
+	return length;
+}
+
+static const sourceScanner sse2Scanner = { "sse2", sse2SkipWhitespace, sse2FindLineEnd, sse2FindCommentEnd };
+
+__attribute__((target("avx2"))) static size_t avx2SkipWhitespace(const char * buffer, size_t position, size_t length, int * lines)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i controlRange = _mm256_set1_epi8('\r' - '\t');
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	for(; position < length; position += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)(buffer + position));
+		__m256i control = _mm256_sub_epi8(block, tab);
+		__m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(_mm256_min_epu8(control, controlRange), control));
+		unsigned int newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+		unsigned int others = ~(unsigned int)_mm256_movemask_epi8(blank);
+
+		if(others) {
+			unsigned int first = __builtin_ctz(others);
+
+			*lines += __builtin_popcount(newlines & ((1u << first) - 1));
+
+			return position + first < length ? position + first : length;
+		}
+
+		*lines += __builtin_popcount(newlines);
+	}
+
+	return length;
+}
+
+__attribute__((target("avx2"))) static size_t avx2FindLineEnd(const char * buffer, size_t position, size_t length)
+{
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	for(; position < length; position += 32) {
+		unsigned int newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(buffer + position)), newline));
+
+		if(newlines)
+			return position + __builtin_ctz(newlines) < length ? position + __builtin_ctz(newlines) : length;
+	}
+
+	return length;
+}
+
+__attribute__((target("avx2"))) static size_t avx2FindCommentEnd(const char * buffer, size_t position, size_t length, int * lines)
+{
+	const __m256i star = _mm256_set1_epi8('*');
+	const __m256i slash = _mm256_set1_epi8('/');
+	const __m256i newline = _mm256_set1_epi8('\n');
+
+	for(; position < length; position += 32) {
+		__m256i block = _mm256_loadu_si256((const __m256i *)(buffer + position));
+		__m256i next = _mm256_loadu_si256((const __m256i *)(buffer + position + 1));
+		unsigned int ends = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block, star), _mm256_cmpeq_epi8(next, slash)));
+		unsigned int newlines = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+
+		if(ends) {
+			unsigned int first = __builtin_ctz(ends);
+
+			*lines += __builtin_popcount(newlines & ((1u << first) - 1));
+
+			return position + first + 2;
+		}
+
+		*lines += __builtin_popcount(newlines);
+	}
+
+	return length;
+}
+
+static const sourceScanner avx2Scanner = { "avx2", avx2SkipWhitespace, avx2FindLineEnd, avx2FindCommentEnd };
+
+#endif
+
+const sourceScanner * selectScanner()
+{
+#ifdef JSCAN_BLOCKS
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2"))
+		return &avx2Scanner;
+
+	if(__builtin_cpu_supports("sse2"))
+		return &sse2Scanner;
+#endif
+
+	return &scalarScanner;
+}
\ No newline at end of file
@@ -5,20 +5,55 @@
 #include "../include/jack.h"
 #include "../include/jsym.h"
 #include "../include/jlex.h"
+#include "../include/jgen.h"
 
 classList classes = { 0 };
 classSymbolTable * currentClass;
 functionSymbolTable * currentFunction;
 variableSymbol * currentVariable;
+extern nodePool * currentNodePool;
 statement * curStatement;
 
-extern FILE * curFile;
+diagnosticHandler diagnosticHook = NULL;
+jmp_buf * errorRecovery = NULL;
+
+unsigned int errorCount = 0;
+int errorStatus = EXEC_SUCCESS; /* Exit status of the first error, which the compiler ends with */
 
 /* Functions for reporting semantic errors during the finalisation stage */
 
+void raiseDiagnostic(diagnosticSeverity severity, const char * message, int lineNum)
+{
+	diagnosticHook(severity, message, lineNum);
+
+	if(severity == severityError)
+		longjmp(*errorRecovery, 1);
+
+	return;
+}
+
+bool countError(int status)
+{
+	if(!errorCount++)
+		errorStatus = status;
+
+	options.checkOnly = true; /* The program is wrong, nothing more is written from here on */
+
+	if(options.maxErrors && errorCount >= (unsigned int)options.maxErrors) {
+		if(options.maxErrors > 1)
+			fprintf(stderr, "\nToo many errors, stopping after %u!\n", errorCount);
+
+		return false;
+	}
+
+	return true;
+}
+
 void semanticWarning(const char * warning)
 {
-	if(!curStatement)
+	if(diagnosticHook)
+		raiseDiagnostic(severityWarning, warning, curStatement ? curStatement->lineNum : currentClass->lineNum);
+	else if(!curStatement)
 		fprintf(stderr, "Semantic warning in class \"%s\": %s!\n", currentClass->name, warning);
 	else
 		fprintf(stderr, "Semantic warning in class \"%s\": %s! (line %d)\n", currentClass->name, warning, curStatement->lineNum);
@@ -26,27 +61,37 @@ void semanticWarning(const char * warning)
 
 void semanticError(const char * error)
 {
+	if(diagnosticHook)
+		raiseDiagnostic(severityError, error, curStatement ? curStatement->lineNum : currentClass->lineNum);
+
 	if(!curStatement)
 		fprintf(stderr, "\nSemantic Error in class \"%s\": %s!\n", currentClass->name, error);
 	else
 		fprintf(stderr, "\nSemantic Error in class \"%s\": %s! (line %d)\n", currentClass->name, error, curStatement->lineNum);
 
-	if(curFile)
-		fclose(curFile);
+	if(countError(SEMANTIC_ERROR) && errorRecovery)
+		longjmp(*errorRecovery, 1);
 
+	discardOutput();
 	freeClasses();
-	exit(SEMANTIC_ERROR);
+	exit(errorStatus);
 }
 
 void finalisationError(const char * error, int lineNum)
 {
-	if(!currentClass)
+	if(diagnosticHook)
+		raiseDiagnostic(severityError, error, lineNum);
+
+	if(currentClass)
 		fprintf(stderr, "\nSemantic error in class \"%s\": %s! (line %d)\n", currentClass->name, error, lineNum);
 	else
 		fprintf(stderr, "\nSemantic error in class: %s! (line %d)\n", error, lineNum);
 
+	if(countError(SEMANTIC_ERROR)) /* The symbol is left as it is, later uses of it report their own errors */
+		return;
+
 	freeClasses();
-	exit(SEMANTIC_ERROR);
+	exit(errorStatus);
 }
 
 /* Symbol and symbol table initialisation functions */
@@ -67,6 +112,24 @@ classSymbolTable * newClassSymbolTable(char * name)
 
 	strncpy(curClass->name, name, strlen(name));
 
+	if(sourceFileName) {
+		if(!(curClass->fileName = calloc(strlen(sourceFileName) + 1, 1))) {
+			fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+			exit(MEM_ERROR);
+		}
+
+		strcpy(curClass->fileName, sourceFileName);
+	}
+
+	if(outputDirectory) {
+		if(!(curClass->outputDirectory = calloc(strlen(outputDirectory) + 1, 1))) {
+			fprintf(stderr, "Error: Could not allocate memory for directory name!\n");
+			exit(MEM_ERROR);
+		}
+
+		strcpy(curClass->outputDirectory, outputDirectory);
+	}
+
 	if(!classes.lastClass) {
 		classes.firstClass = classes.lastClass = curClass;
 	} else {
@@ -88,6 +151,7 @@ functionSymbolTable * newFunctionSymbolTable()
 		exit(MEM_ERROR);
 	}
 
+	curFunction->nodes = currentNodePool = newNodePool();
 	currentFunction = curFunction;
 
 	return curFunction;
@@ -196,7 +260,9 @@ void setFunctionTypeName(functionSymbolTable * curFunction, char * typeName)
 
 void addStatementToFunction(functionSymbolTable * curFunction, statement * curStatement)
 {
-	if(!curFunction->statements) {
+	if(!curStatement) { /* Variable declarations and statements dropped after an error */
+		return;
+	} else if(!curFunction->statements) {
 		curFunction->statements = curFunction->lastStatement = curStatement;
 	} else {
 		curFunction->lastStatement->nextStatement = curStatement;
@@ -255,6 +321,13 @@ void finaliseClass(classSymbolTable * curClass)
 	staticOffset = 0;
 	fieldOffset = 0;
 
+	/* References are collected again from scratch since the classes looked up may have changed */
+
+	for(unsigned int i = 0; i < curClass->referenceCount; i++)
+		free(curClass->references[i]);
+
+	curClass->referenceCount = 0;
+
 	for(variableSymbol * curVariable = curClass->variables; curVariable; curVariable = curVariable->nextVariable) {
 		if(curVariable->type == field) {
 			finaliseClassVariable(curVariable, &fieldOffset);
@@ -297,8 +370,10 @@ void finaliseClassVariable(variableSymbol * curVariable, int * offset)
 
 	verifyVariableType(curVariable);
 	
-	for(variableSymbol * cur = currentClass->variables; cur; cur = cur->nextVariable)
-		if(!strcmp(curVariable->name, cur->name) && (curVariable != cur))
+	/* Only earlier declarations are compared, so every duplicate is reported once at its own line */
+
+	for(variableSymbol * cur = currentClass->variables; cur != curVariable; cur = cur->nextVariable)
+		if(!strcmp(curVariable->name, cur->name))
 			finalisationError("Variable names must be unique", curVariable->lineNum);
 
 	return;
@@ -312,12 +387,8 @@ void finaliseFunctionArgument(variableSymbol * curArgument, int * offset)
 
 	verifyVariableType(curArgument);
 
-	for(variableSymbol * cur = currentFunction->variables; cur; cur = cur->nextVariable)
-		if(!strcmp(curArgument->name, cur->name) && (curArgument != cur))
-			finalisationError("Variable names must be unique", curArgument->lineNum);
-
-	for(variableSymbol * cur = currentFunction->arguments; cur; cur = cur->nextVariable)
-		if(!strcmp(curArgument->name, cur->name) && (curArgument != cur))
+	for(variableSymbol * cur = currentFunction->arguments; cur != curArgument; cur = cur->nextVariable)
+		if(!strcmp(curArgument->name, cur->name))
 			finalisationError("Variable names must be unique", curArgument->lineNum);
 
 	return;
@@ -330,12 +401,12 @@ void finaliseFunctionVariable(variableSymbol * curVariable, int * offset)
 
 	verifyVariableType(curVariable);
 
-	for(variableSymbol * cur = currentFunction->variables; cur; cur = cur->nextVariable)
-		if(!strcmp(curVariable->name, cur->name) && (curVariable != cur))
+	for(variableSymbol * cur = currentFunction->variables; cur != curVariable; cur = cur->nextVariable)
+		if(!strcmp(curVariable->name, cur->name))
 			finalisationError("Variable names must be unique", curVariable->lineNum);
 
 	for(variableSymbol * cur = currentFunction->arguments; cur; cur = cur->nextVariable)
-		if(!strcmp(curVariable->name, cur->name) && (curVariable != cur))
+		if(!strcmp(curVariable->name, cur->name))
 			finalisationError("Variable names must be unique", curVariable->lineNum);
 
 	return;
@@ -348,14 +419,7 @@ void verifyVariableType(variableSymbol * curVariable)
 	} else if(!strcmp(curVariable->typeName, "Array")) {
 		curVariable->construction = array;
 	} else {
-		for(classSymbolTable * curClass = classes.firstClass; curClass; curClass = curClass->nextClass) {
-			if(!strcmp(curVariable->typeName, curClass->name)) {
-				curVariable->typeClass = curClass;
-				break;
-			}
-		}
-
-		if(!curVariable->typeClass)
+		if(!(curVariable->typeClass = lookupClass(curVariable->typeName)))
 			finalisationError("Function type does not exist", curVariable->lineNum);
 
 		curVariable->construction = structure;
@@ -367,14 +431,7 @@ void verifyVariableType(variableSymbol * curVariable)
 void verifyFunctionType(functionSymbolTable * curFunction)
 {
 	if(strcmp(curFunction->typeName, "int") && strcmp(curFunction->typeName, "boolean") && strcmp(curFunction->typeName, "char") && strcmp(curFunction->typeName, "void") && strcmp(curFunction->typeName, "Array")) {
-		for(classSymbolTable * curClass = classes.firstClass; curClass; curClass = curClass->nextClass) {
-			if(!strcmp(curFunction->typeName, curClass->name)) {
-				curFunction->typeClass = curClass;
-				break;
-			}
-		}
-
-		if(!curFunction->typeClass) {
+		if(!(curFunction->typeClass = lookupClass(curFunction->typeName))) {
 			finalisationError("Function type does not exist", curFunction->lineNum);
 		}
 	}
@@ -384,6 +441,44 @@ void verifyFunctionType(functionSymbolTable * curFunction)
 
 /* Utility functions for code generation and semantic analysis */
 
+classSymbolTable * lookupClass(const char * className)
+{
+	/* The name is remembered even if no such class exists, so a class added later is known to affect the current one */
+
+	if(currentClass && strcmp(currentClass->name, className) && !referencesClass(currentClass, className)) {
+		if(!(currentClass->references = realloc(currentClass->references, (currentClass->referenceCount + 1) * sizeof(char *))) || !(currentClass->references[currentClass->referenceCount] = calloc(strlen(className) + 1, 1))) {
+			fprintf(stderr, "Error: Could not allocate memory for class reference!\n");
+			exit(MEM_ERROR);
+		}
+
+		strcpy(currentClass->references[currentClass->referenceCount++], className);
+	}
+
+	for(classSymbolTable * curClass = classes.firstClass; curClass; curClass = curClass->nextClass)
+		if(!strcmp(curClass->name, className))
+			return curClass;
+
+	return NULL;
+}
+
+classSymbolTable * lookupClassFile(const char * fileName)
+{
+	for(classSymbolTable * curClass = classes.firstClass; curClass; curClass = curClass->nextClass)
+		if(curClass->fileName && !strcmp(curClass->fileName, fileName))
+			return curClass;
+
+	return NULL;
+}
+
+bool referencesClass(classSymbolTable * curClass, const char * className)
+{
+	for(unsigned int i = 0; i < curClass->referenceCount; i++)
+		if(!strcmp(curClass->references[i], className))
+			return true;
+
+	return false;
+}
+
 variableSymbol * lookupClassVariable(classSymbolTable * curClass, char * variableName)
 {
 	for(variableSymbol * curVariable = curClass->variables; curVariable; curVariable = curVariable->nextVariable)
@@ -425,6 +520,50 @@ void freeClasses()
 	return;
 }
 
+void removeClass(classSymbolTable * curClass)
+{
+	classSymbolTable * previousClass = NULL;
+
+	for(classSymbolTable * cur = classes.firstClass; cur && cur != curClass; cur = cur->nextClass)
+		previousClass = cur;
+
+	if(previousClass)
+		previousClass->nextClass = curClass->nextClass;
+	else
+		classes.firstClass = curClass->nextClass;
+
+	if(classes.lastClass == curClass)
+		classes.lastClass = previousClass;
+
+	if(currentClass == curClass)
+		currentClass = NULL;
+
+	/* Types are resolved to the class again on the next finalisation, until then they must not point at freed memory */
+
+	for(classSymbolTable * cur = classes.firstClass; cur; cur = cur->nextClass) {
+		for(variableSymbol * curVariable = cur->variables; curVariable; curVariable = curVariable->nextVariable)
+			if(curVariable->typeClass == curClass)
+				curVariable->typeClass = NULL;
+
+		for(functionSymbolTable * curFunction = cur->functions; curFunction; curFunction = curFunction->nextFunction) {
+			if(curFunction->typeClass == curClass)
+				curFunction->typeClass = NULL;
+
+			for(variableSymbol * curVariable = curFunction->arguments; curVariable; curVariable = curVariable->nextVariable)
+				if(curVariable->typeClass == curClass)
+					curVariable->typeClass = NULL;
+
+			for(variableSymbol * curVariable = curFunction->variables; curVariable; curVariable = curVariable->nextVariable)
+				if(curVariable->typeClass == curClass)
+					curVariable->typeClass = NULL;
+		}
+	}
+
+	freeClass(curClass);
+
+	return;
+}
+
 classSymbolTable * freeClass(classSymbolTable * curClass)
 {
 	classSymbolTable * nextClass = curClass->nextClass;
@@ -435,7 +574,13 @@ classSymbolTable * freeClass(classSymbolTable * curClass)
 	for(functionSymbolTable * curFunction = curClass->functions; curFunction; curFunction = freeFunction(curFunction))
 		;
 
+	for(unsigned int i = 0; i < curClass->referenceCount; i++)
+		free(curClass->references[i]);
+
+	free(curClass->references);
 	free(curClass->name);
+	free(curClass->fileName);
+	free(curClass->outputDirectory);
 	free(curClass);
 
 	return nextClass;
@@ -451,7 +596,7 @@ functionSymbolTable * freeFunction(functionSymbolTable * curFunction)
 	for(variableSymbol * curArgument = curFunction->arguments; curArgument; curArgument = freeVariable(curArgument))
 		;
 
-	freeStatement(curFunction->statements);
+	freeNodePool(curFunction->nodes);
 	free(curFunction->typeName);
 	free(curFunction->name);
 	free(curFunction);
@@ -0,0 +1,1056 @@
+#include <dirent.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../include/jack.h"
+#include "../include/jdev.h"
+#include "../include/jvm.h"
+
+int16_t ram[RAM_SIZE];
+bool running = false;
+
+vmInstruction * instructions = NULL;
+int instructionCount = 0;
+int instructionCapacity = 0;
+
+vmFunction * functions = NULL;
+int functionCount = 0;
+
+vmFile * files = NULL;
+int fileCount = 0;
+
+vmLabel * labels = NULL;
+int labelCount = 0;
+
+vmFrame frames[MAX_CALL_DEPTH];
+int frameCount = 0;
+
+int programCounter = 0;
+long steps = 0;
+
+/* Profiling state, instruction counts are kept per instruction and folded into source lines when the profile is written */
+
+bool profiling = false;
+long * instructionCounts = NULL;
+stackNode * rootNode = NULL;
+stackNode * currentNode = NULL;
+
+static const struct option longOptions[] = {
+	{ "keys", required_argument, NULL, 'k' },
+	{ "profile", required_argument, NULL, 'p' },
+	{ "screen", required_argument, NULL, 'd' },
+	{ "steps", required_argument, NULL, 's' },
+	{ "help", no_argument, NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void printUsage(FILE * stream, const char * programName)
+{
+	fprintf(stream, "Usage: ./%s [options] [.vm or .vmb files or directories]\n\n", programName);
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  --keys=FILE\t\tReplay the key events of FILE, lines of \"STEP KEY\", on the keyboard register\n");
+	fprintf(stream, "  --profile=BASE\tWrite BASE.folded, BASE.functions and BASE.lines after the run\n");
+	fprintf(stream, "  --screen=N[,N...]\tWrite the screen to screen-N.pbm after N instructions, \"end\" when the program stops\n");
+	fprintf(stream, "  --steps=N\t\tStop after N VM instructions\n");
+	fprintf(stream, "  -h, --help\t\tDisplay this message\n");
+}
+
+static void * growArray(void * array, int count, int * capacity, size_t size)
+{
+	if(count < *capacity)
+		return array;
+
+	*capacity = *capacity ? *capacity * 2 : 64;
+
+	if(!(array = realloc(array, *capacity * size))) {
+		fprintf(stderr, "Error: Could not allocate memory for the VM program!\n");
+		exit(MEM_ERROR);
+	}
+
+	return array;
+}
+
+static char * copyString(const char * string)
+{
+	char * copy;
+
+	if(!(copy = malloc(strlen(string) + 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for the VM program!\n");
+		exit(MEM_ERROR);
+	}
+
+	return strcpy(copy, string);
+}
+
+static int compareNames(const void * first, const void * second)
+{
+	return strcmp(*(char * const *)first, *(char * const *)second);
+}
+
+/* Functions for loading VM programs */
+
+void loadPath(const char * path)
+{
+	struct stat status;
+	DIR * directory;
+	struct dirent * entry;
+	char ** names = NULL;
+	int nameCount = 0;
+	int nameCapacity = 0;
+
+	if(stat(path, &status)) {
+		fprintf(stderr, "Error: Could not open \'%s\'!\n", path);
+		exit(FILE_ERROR);
+	}
+
+	if(!S_ISDIR(status.st_mode)) {
+		loadFile(path);
+		return;
+	}
+
+	if(!(directory = opendir(path))) {
+		fprintf(stderr, "Error: Could not open directory \'%s\'!\n", path);
+		exit(FILE_ERROR);
+	}
+
+	/* Files of a directory are loaded in name order so runs are reproducible */
+
+	while((entry = readdir(directory))) {
+		size_t length = strlen(entry->d_name);
+		char * name;
+
+		if((length < 4 || strcmp(entry->d_name + length - 3, ".vm")) && (length < 5 || strcmp(entry->d_name + length - 4, ".vmb")))
+			continue;
+
+		if(!(name = malloc(strlen(path) + length + 2))) {
+			fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+			exit(MEM_ERROR);
+		}
+
+		sprintf(name, "%s/%s", path, entry->d_name);
+
+		names = growArray(names, nameCount, &nameCapacity, sizeof(char *));
+		names[nameCount++] = name;
+	}
+
+	closedir(directory);
+
+	if(nameCount)
+		qsort(names, nameCount, sizeof(char *), compareNames);
+
+	for(int i = 0; i < nameCount; i++) {
+		loadFile(names[i]);
+		free(names[i]);
+	}
+
+	free(names);
+
+	return;
+}
+
+void loadFile(const char * fileName)
+{
+	FILE * vmFile = NULL;
+	char line[MAX_LINE_SIZE];
+	const char * baseName = strrchr(fileName, '/') ? strrchr(fileName, '/') + 1 : fileName;
+	int lineNum = 0;
+	bool lineStart = false;
+	int fileCapacity = fileCount;
+	bool isBytecode = strlen(fileName) > 4 && !strcmp(fileName + strlen(fileName) - 4, ".vmb");
+
+	if(!isBytecode && !(vmFile = fopen(fileName, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	if(!(files = realloc(files, (fileCapacity + 1) * sizeof(struct vmFile)))) {
+		fprintf(stderr, "Error: Could not allocate memory for the VM program!\n");
+		exit(MEM_ERROR);
+	}
+
+	/* Static variables belong to the class a file was generated from, which is named after the file */
+
+	files[fileCount].className = copyString(baseName);
+	files[fileCount].sourceName = NULL;
+	files[fileCount].firstInstruction = instructionCount;
+	files[fileCount].staticCount = 0;
+
+	if(strrchr(files[fileCount].className, '.'))
+		*strrchr(files[fileCount].className, '.') = '\0';
+
+	if(isBytecode) {
+		loadBytecode(fileName, fileCount);
+	} else {
+		while(fgets(line, sizeof(line), vmFile))
+			parseLine(line, fileCount, &lineNum, &lineStart);
+
+		fclose(vmFile);
+	}
+	loadSourceMap(fileName, fileCount);
+	fileCount++;
+
+	return;
+}
+
+void parseLine(char * line, int file, int * lineNum, bool * lineStart)
+{
+	char command[MAX_LINE_SIZE];
+	char name[MAX_LINE_SIZE] = { 0 };
+	int argument = 0;
+	int fields;
+	char * comment;
+	unsigned int opcode;
+	vmSegment segment = segNone;
+
+	/* Source line annotations written by "jcomp --profile" apply to the instructions that follow them */
+
+	if(sscanf(line, " // line %d", &argument) == 1) {
+		*lineNum = argument;
+		*lineStart = true;
+		return;
+	}
+
+	if((comment = strstr(line, "//")))
+		*comment = '\0';
+
+	if((fields = sscanf(line, "%s %s %d", command, name, &argument)) < 1)
+		return;
+
+	for(opcode = 0; opcode <= opReturn && strcmp(vmCommandNames[opcode], command); opcode++)
+		;
+
+	if(opcode > opReturn) {
+		fprintf(stderr, "Error: Unknown command \"%s\" in class \"%s\"!\n", command, files[file].className);
+		exit(FILE_ERROR);
+	}
+
+	if(opcode == opPush || opcode == opPop)
+		for(unsigned int i = 0; i < segNone; i++)
+			if(fields == 3 && !strcmp(vmSegmentNames[i], name))
+				segment = i;
+
+	addInstruction(opcode, segment, argument, name, file, lineNum, lineStart);
+
+	return;
+}
+
+void addInstruction(vmOpcode opcode, vmSegment segment, int argument, const char * name, int file, int * lineNum, bool * lineStart)
+{
+	vmInstruction * curInstruction;
+
+	instructions = growArray(instructions, instructionCount, &instructionCapacity, sizeof(vmInstruction));
+	curInstruction = &instructions[instructionCount];
+	memset(curInstruction, 0, sizeof(vmInstruction));
+
+	curInstruction->opcode = opcode;
+	curInstruction->segment = segNone;
+	curInstruction->file = file;
+	curInstruction->lineNum = *lineNum;
+	curInstruction->lineStart = *lineStart;
+	curInstruction->function = functionCount - 1;
+	curInstruction->argument = argument;
+	*lineStart = false;
+
+	if(opcode == opPush || opcode == opPop) {
+		curInstruction->segment = segment;
+
+		if(segment == segNone || (opcode == opPop && segment == segConstant)) {
+			fprintf(stderr, "Error: Invalid segment \"%s\" in class \"%s\"!\n", name, files[file].className);
+			exit(FILE_ERROR);
+		}
+
+		if(segment == segStatic && argument >= files[file].staticCount)
+			files[file].staticCount = argument + 1;
+	} else if(opcode == opFunction) {
+		curInstruction->function = addFunction(name);
+
+		if(functions[curInstruction->function].entry >= 0) {
+			fprintf(stderr, "Error: Function \"%s\" is defined more than once!\n", name);
+			exit(FILE_ERROR);
+		}
+
+		functions[curInstruction->function].entry = instructionCount;
+		functions[curInstruction->function].file = file;
+	} else if(opcode == opCall) {
+		curInstruction->label = copyString(name);
+	} else if(opcode == opLabel || opcode == opGoto || opcode == opIfGoto) {
+		char qualified[2 * MAX_LINE_SIZE];
+
+		/* Labels are local to the function they appear in */
+
+		snprintf(qualified, sizeof(qualified), "%s$%s", functionCount ? functions[functionCount - 1].name : "", name);
+
+		if(opcode == opLabel)
+			addLabel(qualified, instructionCount);
+		else
+			curInstruction->label = copyString(qualified);
+	}
+
+	instructionCount++;
+
+	return;
+}
+
+void loadBytecode(const char * fileName, int file)
+{
+	size_t size;
+	const vmbHeader * header = mapBytecode(fileName, &size);
+	const vmbInstruction * curInstruction = (const vmbInstruction *)(header + 1);
+	const char * strings = (const char *)(curInstruction + header->instructionCount);
+	int lineNum = 0;
+	bool lineStart = false;
+
+	/* Instructions are taken over field by field, only names are looked up in the string table */
+
+	for(uint32_t i = 0; i < header->instructionCount; i++, curInstruction++) {
+		bool named = curInstruction->opcode >= opLabel && curInstruction->opcode <= opCall;
+
+		if(curInstruction->opcode == VMB_LINE) {
+			lineNum = curInstruction->operand;
+			lineStart = true;
+		} else if(curInstruction->opcode == opPush || curInstruction->opcode == opPop) {
+			addInstruction(curInstruction->opcode, curInstruction->argument, curInstruction->operand, vmSegmentNames[curInstruction->argument], file, &lineNum, &lineStart);
+		} else {
+			addInstruction(curInstruction->opcode, segNone, named ? curInstruction->argument : 0, named ? strings + curInstruction->operand : "", file, &lineNum, &lineStart);
+		}
+	}
+
+	unmapBytecode(header, size);
+
+	return;
+}
+
+void loadSourceMap(const char * fileName, int file)
+{
+	FILE * mapFile;
+	char * mapName;
+	char * text;
+	char * position;
+	long length;
+
+	if(!(mapName = malloc(strlen(fileName) + 5))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	sprintf(mapName, "%s.map", fileName);
+	mapFile = fopen(mapName, "r");
+	free(mapName);
+
+	if(!mapFile) /* Files without a map keep the line annotations, if any */
+		return;
+
+	fseek(mapFile, 0, SEEK_END);
+	length = ftell(mapFile);
+	rewind(mapFile);
+
+	if(!(text = calloc(length + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for source map!\n");
+		exit(MEM_ERROR);
+	}
+
+	if(fread(text, 1, length, mapFile) != (size_t)length) {
+		fprintf(stderr, "Error: Could not read source map of \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	fclose(mapFile);
+
+	/* The map is written by jcomp --source-map, so only its fixed layout is understood */
+
+	if((position = strstr(text, "\"file\":\""))) {
+		char * name = position + 8;
+		char * end = name;
+
+		while(*end && *end != '"')
+			end += *end == '\\' && end[1] ? 2 : 1;
+
+		*end = '\0';
+		files[file].sourceName = copyString(name);
+		*end = '"';
+	}
+
+	if((position = strstr(text, "\"runs\":["))) {
+		position += 8;
+
+		for(;;) {
+			int start, count, lineNum, consumed;
+
+			if(sscanf(position, " [%d,%d,%d]%n", &start, &count, &lineNum, &consumed) != 3)
+				break;
+
+			for(int i = 0; i < count; i++) {
+				int index = files[file].firstInstruction + start + i;
+
+				if(index >= instructionCount)
+					break;
+
+				instructions[index].lineNum = lineNum;
+				instructions[index].lineStart = !i;
+			}
+
+			position += consumed;
+
+			if(*position == ',')
+				position++;
+		}
+	}
+
+	free(text);
+
+	return;
+}
+
+int addFunction(const char * name)
+{
+	int function;
+	static int functionCapacity = 0;
+
+	if((function = lookupFunction(name)) >= 0)
+		return function;
+
+	functions = growArray(functions, functionCount, &functionCapacity, sizeof(vmFunction));
+	memset(&functions[functionCount], 0, sizeof(vmFunction));
+
+	functions[functionCount].name = copyString(name);
+	functions[functionCount].entry = -1;
+
+	return functionCount++;
+}
+
+int lookupFunction(const char * name)
+{
+	for(int i = 0; i < functionCount; i++)
+		if(!strcmp(functions[i].name, name))
+			return i;
+
+	return -1;
+}
+
+void addLabel(const char * name, int index)
+{
+	static int labelCapacity = 0;
+
+	labels = growArray(labels, labelCount, &labelCapacity, sizeof(vmLabel));
+	labels[labelCount].name = copyString(name);
+	labels[labelCount++].index = index;
+
+	return;
+}
+
+int lookupLabel(const char * name)
+{
+	vmLabel key = { (char *)name, 0 };
+	vmLabel * found = labelCount ? bsearch(&key, labels, labelCount, sizeof(vmLabel), compareNames) : NULL;
+
+	return found ? found->index : -1;
+}
+
+void resolveProgram()
+{
+	int staticBase = STATIC_BASE;
+
+	if(labelCount) /* A program without any labels has no table at all */
+		qsort(labels, labelCount, sizeof(vmLabel), compareNames);
+
+	for(int i = 0; i < fileCount; i++) {
+		files[i].staticBase = staticBase;
+		staticBase += files[i].staticCount;
+	}
+
+	if(staticBase > STATIC_END) {
+		fprintf(stderr, "Error: Program uses more than %d static variables!\n", STATIC_END - STATIC_BASE);
+		exit(FILE_ERROR);
+	}
+
+	for(int i = 0; i < instructionCount; i++) {
+		if(instructions[i].opcode == opCall) {
+			instructions[i].target = addFunction(instructions[i].label);
+		} else if(instructions[i].opcode == opGoto || instructions[i].opcode == opIfGoto) {
+			if((instructions[i].target = lookupLabel(instructions[i].label)) < 0) {
+				fprintf(stderr, "Error: Jump to undefined label \"%s\"!\n", instructions[i].label);
+				exit(FILE_ERROR);
+			}
+		} else {
+			continue;
+		}
+
+		free(instructions[i].label);
+		instructions[i].label = NULL;
+	}
+
+	/* Subroutines which never return, such as the stubs of an unimplemented OS class, are replaced by the built-in OS */
+
+	for(int i = 0; i < instructionCount; i++)
+		if(instructions[i].opcode == opReturn && instructions[i].function >= 0)
+			functions[instructions[i].function].hasBody = true;
+
+	for(int i = 0; i < functionCount; i++)
+		if(!functions[i].hasBody)
+			functions[i].native = lookupNative(functions[i].name);
+
+	return;
+}
+
+/* Functions for running VM programs */
+
+void runtimeError(const char * message)
+{
+	fprintf(stderr, "Error: %s in \"%s\" after %ld instructions!\n", message, functions[instructions[programCounter].function].name, steps);
+	exit(RUNTIME_ERROR);
+}
+
+int16_t * segmentAddress(vmSegment segment, int index, int file)
+{
+	int address;
+
+	switch(segment) {
+		case segLocal:
+			address = ram[LCL] + index;
+			break;
+		case segArgument:
+			address = ram[ARG] + index;
+			break;
+		case segThis:
+			address = (uint16_t)ram[THIS] + index;
+			break;
+		case segThat:
+			address = (uint16_t)ram[THAT] + index;
+			break;
+		case segPointer:
+			address = THIS + index;
+			break;
+		case segTemp:
+			address = TEMP_BASE + index;
+			break;
+		case segStatic:
+			address = files[file].staticBase + index;
+			break;
+		default:
+			address = -1;
+			break;
+	}
+
+	if(address < 0 || address >= RAM_SIZE)
+		runtimeError("Memory access out of range");
+
+	return &ram[address];
+}
+
+void callFunction(int function, int argumentCount, int returnIndex)
+{
+	vmFunction * callee = &functions[function];
+
+	if(profiling) {
+		callee->calls++;
+
+		if(!callee->activeCount++)
+			callee->entryCount = steps;
+	}
+
+	if(!callee->hasBody) {
+		int16_t result;
+
+		if(!callee->native) {
+			fprintf(stderr, "Error: Call to undefined function \"%s\"!\n", callee->name);
+			exit(RUNTIME_ERROR);
+		}
+
+		if(argumentCount != callee->native->argumentCount)
+			runtimeError("Wrong number of arguments to built-in function");
+
+		/* Built-in functions take their arguments straight from the stack and count as a single instruction */
+
+		result = callee->native->implementation(&ram[ram[SP] - argumentCount]);
+		steps++;
+		ram[SP] -= argumentCount;
+		ram[ram[SP]++] = result;
+		programCounter = returnIndex;
+
+		if(profiling) {
+			enterStackNode(currentNode, function)->count++;
+			callee->exclusive++;
+			callee->inclusive += !--callee->activeCount;
+		}
+
+		return;
+	}
+
+	if(frameCount == MAX_CALL_DEPTH || ram[SP] + 5 >= HEAP_BASE)
+		runtimeError("Stack overflow");
+
+	frames[frameCount].returnIndex = returnIndex;
+	frames[frameCount].function = function;
+	frames[frameCount].entryCount = steps;
+	frames[frameCount++].node = currentNode;
+
+	if(profiling)
+		currentNode = enterStackNode(currentNode, function);
+
+	/* The frame is laid out in RAM as usual so programs that inspect it see the same memory */
+
+	ram[ram[SP]] = (int16_t)returnIndex;
+	ram[ram[SP] + 1] = ram[LCL];
+	ram[ram[SP] + 2] = ram[ARG];
+	ram[ram[SP] + 3] = ram[THIS];
+	ram[ram[SP] + 4] = ram[THAT];
+	ram[ARG] = ram[SP] - argumentCount;
+	ram[SP] += 5;
+	ram[LCL] = ram[SP];
+
+	programCounter = callee->entry;
+
+	return;
+}
+
+void returnFromFunction()
+{
+	int frame = ram[LCL];
+	vmFrame * curFrame = &frames[--frameCount];
+	vmFunction * callee = &functions[curFrame->function];
+
+	ram[ram[ARG]] = ram[ram[SP] - 1];
+	ram[SP] = ram[ARG] + 1;
+	ram[THAT] = ram[frame - 1];
+	ram[THIS] = ram[frame - 2];
+	ram[ARG] = ram[frame - 3];
+	ram[LCL] = ram[frame - 4];
+
+	if(profiling) {
+		if(!--callee->activeCount)
+			callee->inclusive += steps - callee->entryCount;
+
+		currentNode = curFrame->node;
+	}
+
+	if((programCounter = curFrame->returnIndex) < 0)
+		running = false;
+
+	return;
+}
+
+void runProgram(long maxSteps)
+{
+	int entry;
+
+	memset(ram, 0, sizeof(ram));
+	ram[SP] = STACK_BASE;
+	initNativeOS();
+
+	/* Programs with their own Sys.init start there, otherwise the built-in OS starts Main.main directly */
+
+	if((entry = lookupFunction("Sys.init")) < 0 || !functions[entry].hasBody)
+		entry = lookupFunction("Main.main");
+
+	if(entry < 0 || !functions[entry].hasBody) {
+		fprintf(stderr, "Error: Program has neither Sys.init nor Main.main!\n");
+		exit(RUNTIME_ERROR);
+	}
+
+	if(profiling) {
+		if(!(instructionCounts = calloc(instructionCount, sizeof(long)))) {
+			fprintf(stderr, "Error: Could not allocate memory for the profile!\n");
+			exit(MEM_ERROR);
+		}
+
+		rootNode = currentNode = enterStackNode(NULL, -1);
+	}
+
+	if(strcmp(functions[entry].name, "Sys.init")) /* The OS classes the program implements itself still need the initialisation Sys.init would do */
+		initProgramOS();
+
+	running = true;
+	callFunction(entry, 0, -1);
+	executeProgram(maxSteps);
+
+	finishDevices(ram, steps);
+
+	/* Subroutines still running when the program stops are charged up to this point */
+
+	while(profiling && frameCount) {
+		vmFunction * curFunction = &functions[frames[--frameCount].function];
+
+		if(!--curFunction->activeCount)
+			curFunction->inclusive += steps - curFunction->entryCount;
+	}
+
+	fflush(stdout);
+
+	return;
+}
+
+int16_t callProgram(int function, const int16_t * arguments, int argumentCount)
+{
+	int returnIndex = programCounter;
+	bool wasRunning = running;
+	int16_t result;
+
+	/* Runs a subroutine of the program to its return from inside a built-in one, the call returns to nowhere which stops the nested run */
+
+	for(int i = 0; i < argumentCount; i++)
+		ram[ram[SP]++] = arguments[i];
+
+	running = true;
+	callFunction(function, argumentCount, -1);
+	executeProgram(0);
+
+	result = ram[--ram[SP]];
+	programCounter = returnIndex;
+	running = wasRunning;
+
+	return result;
+}
+
+void executeProgram(long maxSteps)
+{
+	vmInstruction * curInstruction;
+	int16_t value;
+	long nextEvent = nextDeviceEvent();
+
+	while(running && (!maxSteps || steps < maxSteps)) {
+		if(steps >= nextEvent) {
+			processDeviceEvents(ram, steps);
+			nextEvent = nextDeviceEvent();
+		}
+
+		if(programCounter < 0 || programCounter >= instructionCount)
+			runtimeError("Jump outside of the program");
+
+		curInstruction = &instructions[programCounter];
+		steps++;
+
+		if(profiling) {
+			instructionCounts[programCounter]++;
+			currentNode->count++;
+			functions[curInstruction->function].exclusive++;
+		}
+
+		if(ram[SP] < STACK_BASE || ram[SP] >= HEAP_BASE)
+			runtimeError("Stack pointer out of range");
+
+		switch(curInstruction->opcode) {
+			case opPush:
+				value = curInstruction->segment == segConstant ? curInstruction->argument : *segmentAddress(curInstruction->segment, curInstruction->argument, curInstruction->file);
+				ram[ram[SP]++] = value;
+				break;
+			case opPop:
+				value = ram[--ram[SP]];
+				*segmentAddress(curInstruction->segment, curInstruction->argument, curInstruction->file) = value;
+				break;
+			case opAdd:
+				ram[SP]--;
+				ram[ram[SP] - 1] = (int16_t)(ram[ram[SP] - 1] + ram[ram[SP]]);
+				break;
+			case opSub:
+				ram[SP]--;
+				ram[ram[SP] - 1] = (int16_t)(ram[ram[SP] - 1] - ram[ram[SP]]);
+				break;
+			case opNeg:
+				ram[ram[SP] - 1] = (int16_t)-ram[ram[SP] - 1];
+				break;
+			case opEq:
+				ram[SP]--;
+				ram[ram[SP] - 1] = ram[ram[SP] - 1] == ram[ram[SP]] ? -1 : 0;
+				break;
+			case opGt:
+				ram[SP]--;
+				ram[ram[SP] - 1] = ram[ram[SP] - 1] > ram[ram[SP]] ? -1 : 0;
+				break;
+			case opLt:
+				ram[SP]--;
+				ram[ram[SP] - 1] = ram[ram[SP] - 1] < ram[ram[SP]] ? -1 : 0;
+				break;
+			case opAnd:
+				ram[SP]--;
+				ram[ram[SP] - 1] &= ram[ram[SP]];
+				break;
+			case opOr:
+				ram[SP]--;
+				ram[ram[SP] - 1] |= ram[ram[SP]];
+				break;
+			case opNot:
+				ram[ram[SP] - 1] = ~ram[ram[SP] - 1];
+				break;
+			case opLabel:
+				break;
+			case opGoto:
+				programCounter = curInstruction->target;
+				continue;
+			case opIfGoto:
+				if(ram[--ram[SP]]) {
+					programCounter = curInstruction->target;
+					continue;
+				}
+
+				break;
+			case opFunction:
+				for(int i = 0; i < curInstruction->argument; i++)
+					ram[ram[SP]++] = 0;
+
+				break;
+			case opCall:
+				callFunction(curInstruction->target, curInstruction->argument, programCounter + 1);
+				continue;
+			case opReturn:
+				returnFromFunction();
+				continue;
+		}
+
+		programCounter++;
+	}
+
+	return;
+}
+
+/* Functions for profiling */
+
+stackNode * enterStackNode(stackNode * parent, int function)
+{
+	stackNode * curNode;
+
+	for(curNode = parent ? parent->firstChild : NULL; curNode; curNode = curNode->nextSibling)
+		if(curNode->function == function)
+			return curNode;
+
+	if(!(curNode = calloc(1, sizeof(stackNode)))) {
+		fprintf(stderr, "Error: Could not allocate memory for the profile!\n");
+		exit(MEM_ERROR);
+	}
+
+	curNode->function = function;
+	curNode->parent = parent;
+
+	if(parent) {
+		curNode->nextSibling = parent->firstChild;
+		parent->firstChild = curNode;
+	}
+
+	return curNode;
+}
+
+static int compareInclusive(const void * first, const void * second)
+{
+	const vmFunction * a = *(const vmFunction **)first;
+	const vmFunction * b = *(const vmFunction **)second;
+
+	if(a->inclusive != b->inclusive)
+		return a->inclusive < b->inclusive ? 1 : -1;
+
+	return strcmp(a->name, b->name);
+}
+
+typedef struct lineProfile {
+	int file;
+	int lineNum;
+	long hits;
+	long instructions;
+} lineProfile;
+
+static int compareLines(const void * first, const void * second)
+{
+	const lineProfile * a = first;
+	const lineProfile * b = second;
+
+	if(a->file != b->file)
+		return strcmp(files[a->file].className, files[b->file].className);
+
+	return a->lineNum - b->lineNum;
+}
+
+static FILE * openProfileFile(const char * baseName, const char * extension)
+{
+	FILE * profileFile;
+	char * fileName;
+
+	if(!(fileName = malloc(strlen(baseName) + strlen(extension) + 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	sprintf(fileName, "%s%s", baseName, extension);
+
+	if(!(profileFile = fopen(fileName, "w"))) {
+		fprintf(stderr, "Error: Could not open file \"%s\" for writing!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	free(fileName);
+
+	return profileFile;
+}
+
+void writeProfile(const char * baseName)
+{
+	FILE * profileFile;
+	vmFunction ** sorted;
+	lineProfile * lines;
+	int sortedCount = 0;
+	int lineCount = 0;
+
+	/* Folded stacks, one line per distinct call stack with the instructions executed in its innermost function */
+
+	profileFile = openProfileFile(baseName, ".folded");
+	writeFoldedStacks(profileFile, rootNode, "");
+	fclose(profileFile);
+
+	/* Call counts with inclusive and exclusive instruction counts */
+
+	if(!(sorted = calloc(functionCount + 1, sizeof(vmFunction *))) || !(lines = calloc(instructionCount + 1, sizeof(lineProfile)))) {
+		fprintf(stderr, "Error: Could not allocate memory for the profile!\n");
+		exit(MEM_ERROR);
+	}
+
+	for(int i = 0; i < functionCount; i++)
+		if(functions[i].calls)
+			sorted[sortedCount++] = &functions[i];
+
+	qsort(sorted, sortedCount, sizeof(vmFunction *), compareInclusive);
+
+	profileFile = openProfileFile(baseName, ".functions");
+	fprintf(profileFile, "# function\tcalls\tinclusive\texclusive\n");
+
+	for(int i = 0; i < sortedCount; i++)
+		fprintf(profileFile, "%s\t%ld\t%ld\t%ld\n", sorted[i]->name, sorted[i]->calls, sorted[i]->inclusive, sorted[i]->exclusive);
+
+	fclose(profileFile);
+
+	/* Source lines, a hit is an execution of the first instruction generated for the line */
+
+	for(int i = 0; i < instructionCount; i++) {
+		if(!instructions[i].lineNum)
+			continue;
+
+		if(!lineCount || lines[lineCount - 1].file != instructions[i].file || lines[lineCount - 1].lineNum != instructions[i].lineNum) {
+			lines[lineCount].file = instructions[i].file;
+			lines[lineCount].lineNum = instructions[i].lineNum;
+			lines[lineCount].hits = lines[lineCount].instructions = 0;
+			lineCount++;
+		}
+
+		lines[lineCount - 1].hits += instructions[i].lineStart ? instructionCounts[i] : 0;
+		lines[lineCount - 1].instructions += instructionCounts[i];
+	}
+
+	qsort(lines, lineCount, sizeof(lineProfile), compareLines);
+
+	profileFile = openProfileFile(baseName, ".lines");
+	fprintf(profileFile, "# line\thits\tinstructions\n");
+
+	for(int i = 0; i < lineCount; i++) {
+		long hits = lines[i].hits;
+		long total = lines[i].instructions;
+
+		/* The same line may be split over several runs of instructions, e.g. the test of a while loop */
+
+		for(; i + 1 < lineCount && !compareLines(&lines[i], &lines[i + 1]); i++) {
+			hits += lines[i + 1].hits;
+			total += lines[i + 1].instructions;
+		}
+
+		if(!total)
+			continue;
+
+		if(files[lines[i].file].sourceName)
+			fprintf(profileFile, "%s:%d\t%ld\t%ld\n", files[lines[i].file].sourceName, lines[i].lineNum, hits, total);
+		else
+			fprintf(profileFile, "%s.jack:%d\t%ld\t%ld\n", files[lines[i].file].className, lines[i].lineNum, hits, total);
+	}
+
+	fclose(profileFile);
+
+	free(lines);
+	free(sorted);
+
+	return;
+}
+
+void writeFoldedStacks(FILE * profileFile, stackNode * node, const char * path)
+{
+	for(stackNode * child = node->firstChild; child; child = child->nextSibling) {
+		char * childPath;
+
+		if(!(childPath = malloc(strlen(path) + strlen(functions[child->function].name) + 2))) {
+			fprintf(stderr, "Error: Could not allocate memory for the profile!\n");
+			exit(MEM_ERROR);
+		}
+
+		sprintf(childPath, "%s%s%s", path, *path ? ";" : "", functions[child->function].name);
+
+		if(child->count)
+			fprintf(profileFile, "%s %ld\n", childPath, child->count);
+
+		writeFoldedStacks(profileFile, child, childPath);
+		free(childPath);
+	}
+
+	return;
+}
+
+void freeStackNodes(stackNode * node)
+{
+	stackNode * nextNode;
+
+	for(stackNode * child = node ? node->firstChild : NULL; child; child = nextNode) {
+		nextNode = child->nextSibling;
+		freeStackNodes(child);
+	}
+
+	free(node);
+
+	return;
+}
+
+int main(int argc, char * argv[])
+{
+	int option;
+	long maxSteps = 0;
+	char * profileBase = NULL;
+
+	while((option = getopt_long(argc, argv, "h", longOptions, NULL)) != -1) {
+		switch(option) {
+			case 'd':
+				parseScreenDumps(optarg);
+				break;
+			case 'k':
+				loadKeyTrace(optarg);
+				break;
+			case 'p':
+				profileBase = optarg;
+				profiling = true;
+				break;
+			case 's':
+				maxSteps = atol(optarg);
+				break;
+			case 'h':
+				printUsage(stdout, argv[0]);
+				exit(EXEC_SUCCESS);
+			default:
+				printUsage(stderr, argv[0]);
+				exit(FILE_ERROR);
+		}
+	}
+
+	if(optind == argc) {
+		fprintf(stderr, "Error: No input files given!\n\n");
+		printUsage(stderr, argv[0]);
+		return FILE_ERROR;
+	}
+
+	for(int i = optind; i < argc; i++)
+		loadPath(argv[i]);
+
+	resolveProgram();
+	runProgram(maxSteps);
+
+	if(profiling)
+		writeProfile(profileBase);
+
+	freeDevices();
+	freeStackNodes(rootNode);
+	free(instructionCounts);
+
+	return EXEC_SUCCESS;
+}
\ No newline at end of file
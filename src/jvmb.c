@@ -0,0 +1,220 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/jack.h"
+#include "../include/jvmb.h"
+
+const char * vmCommandNames[] = { "push", "pop", "add", "sub", "neg", "eq", "gt", "lt", "and", "or", "not", "label", "goto", "if-goto", "function", "call", "return" };
+const char * vmSegmentNames[] = { "constant", "local", "argument", "this", "that", "pointer", "temp", "static" };
+
+void encodeCommand(vmbBuffer * buffer, const char * line)
+{
+	char command[16] = { 0 };
+	char name[256] = { 0 };
+	int argument = 0;
+	int fields = 0;
+	vmbInstruction * curInstruction;
+
+	if(sscanf(line, " // line %d", &argument) != 1 && (!strncmp(line, "//", 2) || (fields = sscanf(line, "%15s %255s %d", command, name, &argument)) < 1))
+		return;
+
+	if(buffer->instructionCount == buffer->instructionCapacity) {
+		buffer->instructionCapacity = buffer->instructionCapacity ? buffer->instructionCapacity * 2 : 256;
+
+		if(!(buffer->instructions = realloc(buffer->instructions, buffer->instructionCapacity * sizeof(vmbInstruction)))) {
+			fprintf(stderr, "Error: Could not allocate memory for bytecode!\n");
+			exit(MEM_ERROR);
+		}
+	}
+
+	curInstruction = &buffer->instructions[buffer->instructionCount++];
+	memset(curInstruction, 0, sizeof(vmbInstruction));
+
+	if(!*command) {
+		curInstruction->opcode = VMB_LINE;
+		curInstruction->operand = argument;
+		return;
+	}
+
+	for(curInstruction->opcode = 0; curInstruction->opcode <= opReturn && strcmp(vmCommandNames[curInstruction->opcode], command); curInstruction->opcode++)
+		;
+
+	if(curInstruction->opcode > opReturn || argument < 0 || argument > VMB_MAX_OPERAND) {
+		fprintf(stderr, "Error: Command \"%s\" cannot be encoded as bytecode!\n", line);
+		exit(SEMANTIC_ERROR);
+	}
+
+	switch(curInstruction->opcode) {
+		case opPush:
+		case opPop:
+			for(curInstruction->argument = 0; curInstruction->argument < segNone && strcmp(vmSegmentNames[curInstruction->argument], name); curInstruction->argument++)
+				;
+
+			if(fields < 3 || curInstruction->argument == segNone) {
+				fprintf(stderr, "Error: Invalid segment \"%s\" cannot be encoded as bytecode!\n", name);
+				exit(SEMANTIC_ERROR);
+			}
+
+			curInstruction->operand = argument;
+			break;
+		case opFunction:
+		case opCall:
+			if(argument > VMB_MAX_ARGUMENT) {
+				fprintf(stderr, "Error: Command \"%s\" cannot be encoded as bytecode!\n", line);
+				exit(SEMANTIC_ERROR);
+			}
+
+			curInstruction->argument = argument;
+			curInstruction->operand = encodeString(buffer, name);
+			break;
+		case opLabel:
+		case opGoto:
+		case opIfGoto:
+			curInstruction->operand = encodeString(buffer, name);
+			break;
+		default:
+			break;
+	}
+
+	return;
+}
+
+uint16_t encodeString(vmbBuffer * buffer, const char * string)
+{
+	size_t length = strlen(string) + 1;
+	uint32_t offset;
+
+	/* Labels are mostly referenced more than once, so the names already in the table are shared */
+
+	for(offset = 0; offset < buffer->stringTableSize; offset += strlen(buffer->strings + offset) + 1)
+		if(!strcmp(buffer->strings + offset, string))
+			return offset;
+
+	if(offset + length > VMB_MAX_OPERAND + 1) {
+		fprintf(stderr, "Error: String table of the bytecode is full!\n");
+		exit(SEMANTIC_ERROR);
+	}
+
+	if(offset + length > buffer->stringTableCapacity) {
+		buffer->stringTableCapacity = (offset + length) * 2;
+
+		if(!(buffer->strings = realloc(buffer->strings, buffer->stringTableCapacity))) {
+			fprintf(stderr, "Error: Could not allocate memory for bytecode!\n");
+			exit(MEM_ERROR);
+		}
+	}
+
+	memcpy(buffer->strings + offset, string, length);
+	buffer->stringTableSize += length;
+
+	return offset;
+}
+
+void writeBytecode(vmbBuffer * buffer, FILE * vmbFile)
+{
+	vmbHeader header;
+
+	memcpy(header.magic, VMB_MAGIC, 4);
+	header.version = VMB_VERSION;
+	header.instructionCount = buffer->instructionCount;
+	header.stringTableSize = buffer->stringTableSize;
+
+	fwrite(&header, sizeof(vmbHeader), 1, vmbFile);
+	fwrite(buffer->instructions, sizeof(vmbInstruction), buffer->instructionCount, vmbFile);
+	fwrite(buffer->strings, 1, buffer->stringTableSize, vmbFile);
+
+	return;
+}
+
+void freeBytecode(vmbBuffer * buffer)
+{
+	free(buffer->instructions);
+	free(buffer->strings);
+	memset(buffer, 0, sizeof(vmbBuffer));
+
+	return;
+}
+
+const vmbHeader * mapBytecode(const char * fileName, size_t * size)
+{
+	int descriptor;
+	struct stat status;
+	const vmbHeader * header;
+
+	if((descriptor = open(fileName, O_RDONLY)) < 0 || fstat(descriptor, &status)) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	*size = status.st_size;
+
+	if(*size < sizeof(vmbHeader)) {
+		fprintf(stderr, "Error: \'%s\' is not a valid bytecode file!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	if((header = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, descriptor, 0)) == MAP_FAILED) {
+		fprintf(stderr, "Error: Could not map bytecode file \'%s\'!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	close(descriptor);
+
+	/* Everything is used in place, so the layout is checked once here instead of on every access */
+
+	if(memcmp(header->magic, VMB_MAGIC, 4) || header->version != VMB_VERSION || *size != sizeof(vmbHeader) + (size_t)header->instructionCount * sizeof(vmbInstruction) + header->stringTableSize || (header->stringTableSize && ((const char *)header)[*size - 1])) {
+		fprintf(stderr, "Error: \'%s\' is not a valid bytecode file!\n", fileName);
+		exit(FILE_ERROR);
+	}
+
+	for(uint32_t i = 0; i < header->instructionCount; i++) {
+		const vmbInstruction * curInstruction = (const vmbInstruction *)(header + 1) + i;
+		bool named = curInstruction->opcode >= opLabel && curInstruction->opcode <= opCall;
+
+		if((curInstruction->opcode > opReturn && curInstruction->opcode != VMB_LINE) || (curInstruction->opcode <= opPop && curInstruction->argument >= segNone) || (named && curInstruction->operand >= header->stringTableSize)) {
+			fprintf(stderr, "Error: \'%s\' is not a valid bytecode file!\n", fileName);
+			exit(FILE_ERROR);
+		}
+	}
+
+	return header;
+}
+
+void unmapBytecode(const vmbHeader * header, size_t size)
+{
+	munmap((void *)header, size);
+
+	return;
+}
+
+void decodeInstruction(FILE * vmFile, const vmbInstruction * instruction, const char * strings)
+{
+	switch(instruction->opcode) {
+		case VMB_LINE:
+			fprintf(vmFile, "// line %d\n", instruction->operand);
+			break;
+		case opPush:
+		case opPop:
+			fprintf(vmFile, "%s %s %d\n", vmCommandNames[instruction->opcode], vmSegmentNames[instruction->argument], instruction->operand);
+			break;
+		case opFunction:
+		case opCall:
+			fprintf(vmFile, "%s %s %d\n", vmCommandNames[instruction->opcode], strings + instruction->operand, instruction->argument);
+			break;
+		case opLabel:
+		case opGoto:
+		case opIfGoto:
+			fprintf(vmFile, "%s %s\n", vmCommandNames[instruction->opcode], strings + instruction->operand);
+			break;
+		default:
+			fprintf(vmFile, "%s\n", vmCommandNames[instruction->opcode]);
+			break;
+	}
+
+	return;
+}
\ No newline at end of file
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/jack.h"
+#include "../include/jvm.h"
+
+/* Native stand-ins for the Jack OS, used for every OS subroutine the program does not implement itself. Strings live
+ * on the heap as their length, their capacity and then their characters */
+
+#define STRING_LENGTH 0
+#define STRING_CAPACITY 1
+#define STRING_CHARS 2
+#define MAX_INPUT_SIZE 80
+
+int freeList = 0;
+bool screenColour = true;
+
+/* Memory.alloc and Memory.deAlloc of a program with its own allocator, which the built-in functions have to allocate through as well */
+
+int programAlloc = -1;
+int programDeAlloc = -1;
+
+extern vmFunction * functions;
+
+static void nativeError(int errorCode)
+{
+	fprintf(stderr, "Error: Sys.error(%d) called!\n", errorCode);
+	exit(RUNTIME_ERROR);
+}
+
+static int16_t allocate(int size)
+{
+	int previous = 0;
+
+	if(size < 1)
+		nativeError(5);
+
+	if(programAlloc >= 0) {
+		int16_t argument = size;
+
+		return callProgram(programAlloc, &argument, 1);
+	}
+
+	/* First fit over a list of free blocks, each holding its length including the header and the next free block */
+
+	for(int block = freeList; block; previous = block, block = ram[block + 1]) {
+		if(ram[block] < size + 1)
+			continue;
+
+		int next = ram[block + 1];
+
+		if(ram[block] >= size + 3) { /* Split off the remainder when it can still hold a block of its own */
+			next = block + size + 1;
+			ram[next] = ram[block] - size - 1;
+			ram[next + 1] = ram[block + 1];
+			ram[block] = size + 1;
+		}
+
+		if(previous)
+			ram[previous + 1] = next;
+		else
+			freeList = next;
+
+		return block + 1;
+	}
+
+	nativeError(6);
+
+	return 0;
+}
+
+static void deallocate(int address)
+{
+	int block = address - 1;
+
+	if(programDeAlloc >= 0) {
+		int16_t argument = address;
+
+		callProgram(programDeAlloc, &argument, 1);
+
+		return;
+	}
+
+	ram[block + 1] = freeList;
+	freeList = block;
+
+	return;
+}
+
+static void printString(int string)
+{
+	for(int i = 0; i < ram[string + STRING_LENGTH]; i++)
+		putchar(ram[string + STRING_CHARS + i] == 128 ? '\n' : ram[string + STRING_CHARS + i]);
+
+	return;
+}
+
+static void drawPixel(int x, int y)
+{
+	int address;
+
+	if(x < 0 || x > 511 || y < 0 || y > 255)
+		nativeError(7);
+
+	address = SCREEN_BASE + y * 32 + x / 16;
+
+	if(screenColour)
+		ram[address] |= (int16_t)(1 << (x % 16));
+	else
+		ram[address] &= (int16_t)~(1 << (x % 16));
+
+	return;
+}
+
+static void drawHorizontalLine(int x1, int x2, int y)
+{
+	for(int x = x1 < x2 ? x1 : x2; x <= (x1 < x2 ? x2 : x1); x++)
+		drawPixel(x, y);
+
+	return;
+}
+
+/* Math */
+
+static int16_t mathInit(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t mathAbs(int16_t * arguments) { return arguments[0] < 0 ? -arguments[0] : arguments[0]; }
+static int16_t mathMultiply(int16_t * arguments) { return (int16_t)(arguments[0] * arguments[1]); }
+static int16_t mathMin(int16_t * arguments) { return arguments[0] < arguments[1] ? arguments[0] : arguments[1]; }
+static int16_t mathMax(int16_t * arguments) { return arguments[0] > arguments[1] ? arguments[0] : arguments[1]; }
+
+static int16_t mathDivide(int16_t * arguments)
+{
+	if(!arguments[1])
+		nativeError(3);
+
+	return arguments[0] / arguments[1];
+}
+
+static int16_t mathSqrt(int16_t * arguments)
+{
+	int root = 0;
+
+	if(arguments[0] < 0)
+		nativeError(4);
+
+	while((root + 1) * (root + 1) <= arguments[0])
+		root++;
+
+	return root;
+}
+
+/* Memory and Array */
+
+static int16_t memoryInit(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t memoryPeek(int16_t * arguments) { return ram[(uint16_t)arguments[0] % RAM_SIZE]; }
+static int16_t memoryPoke(int16_t * arguments) { ram[(uint16_t)arguments[0] % RAM_SIZE] = arguments[1]; return 0; }
+static int16_t memoryAlloc(int16_t * arguments) { return allocate(arguments[0]); }
+static int16_t memoryDeAlloc(int16_t * arguments) { deallocate(arguments[0]); return 0; }
+
+static int16_t arrayNew(int16_t * arguments)
+{
+	if(arguments[0] <= 0)
+		nativeError(2);
+
+	return allocate(arguments[0]);
+}
+
+/* String */
+
+static int16_t stringNew(int16_t * arguments)
+{
+	int16_t string;
+
+	if(arguments[0] < 0)
+		nativeError(14);
+
+	string = allocate(arguments[0] + STRING_CHARS);
+	ram[string + STRING_LENGTH] = 0;
+	ram[string + STRING_CAPACITY] = arguments[0];
+
+	return string;
+}
+
+static int16_t stringLength(int16_t * arguments) { return ram[arguments[0] + STRING_LENGTH]; }
+static int16_t stringNewLine(int16_t * arguments) { (void)arguments; return 128; }
+static int16_t stringBackSpace(int16_t * arguments) { (void)arguments; return 129; }
+static int16_t stringDoubleQuote(int16_t * arguments) { (void)arguments; return 34; }
+
+static int16_t stringCharAt(int16_t * arguments)
+{
+	if(arguments[1] < 0 || arguments[1] >= ram[arguments[0] + STRING_LENGTH])
+		nativeError(15);
+
+	return ram[arguments[0] + STRING_CHARS + arguments[1]];
+}
+
+static int16_t stringSetCharAt(int16_t * arguments)
+{
+	if(arguments[1] < 0 || arguments[1] >= ram[arguments[0] + STRING_LENGTH])
+		nativeError(16);
+
+	ram[arguments[0] + STRING_CHARS + arguments[1]] = arguments[2];
+
+	return 0;
+}
+
+static int16_t stringAppendChar(int16_t * arguments)
+{
+	if(ram[arguments[0] + STRING_LENGTH] >= ram[arguments[0] + STRING_CAPACITY])
+		nativeError(17);
+
+	ram[arguments[0] + STRING_CHARS + ram[arguments[0] + STRING_LENGTH]++] = arguments[1];
+
+	return arguments[0];
+}
+
+static int16_t stringEraseLastChar(int16_t * arguments)
+{
+	if(!ram[arguments[0] + STRING_LENGTH])
+		nativeError(18);
+
+	ram[arguments[0] + STRING_LENGTH]--;
+
+	return 0;
+}
+
+static int16_t stringIntValue(int16_t * arguments)
+{
+	int value = 0;
+	int i = 0;
+	bool negative = ram[arguments[0] + STRING_LENGTH] > 0 && ram[arguments[0] + STRING_CHARS] == '-';
+
+	for(i = negative; i < ram[arguments[0] + STRING_LENGTH] && ram[arguments[0] + STRING_CHARS + i] >= '0' && ram[arguments[0] + STRING_CHARS + i] <= '9'; i++)
+		value = value * 10 + ram[arguments[0] + STRING_CHARS + i] - '0';
+
+	return (int16_t)(negative ? -value : value);
+}
+
+static int16_t stringSetInt(int16_t * arguments)
+{
+	char digits[8];
+	int length = snprintf(digits, sizeof(digits), "%d", arguments[1]);
+
+	if(length > ram[arguments[0] + STRING_CAPACITY])
+		nativeError(19);
+
+	for(int i = 0; i < length; i++)
+		ram[arguments[0] + STRING_CHARS + i] = digits[i];
+
+	ram[arguments[0] + STRING_LENGTH] = length;
+
+	return 0;
+}
+
+/* Output */
+
+static int16_t outputInit(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t outputMoveCursor(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t outputPrintChar(int16_t * arguments) { putchar(arguments[0] == 128 ? '\n' : arguments[0] == 129 ? '\b' : arguments[0]); return 0; }
+static int16_t outputPrintString(int16_t * arguments) { printString(arguments[0]); return 0; }
+static int16_t outputPrintInt(int16_t * arguments) { printf("%d", arguments[0]); return 0; }
+static int16_t outputPrintln(int16_t * arguments) { (void)arguments; putchar('\n'); return 0; }
+static int16_t outputBackSpace(int16_t * arguments) { (void)arguments; putchar('\b'); return 0; }
+
+/* Screen */
+
+static int16_t screenInit(int16_t * arguments) { (void)arguments; screenColour = true; return 0; }
+static int16_t screenSetColor(int16_t * arguments) { screenColour = arguments[0] != 0; return 0; }
+static int16_t screenDrawPixel(int16_t * arguments) { drawPixel(arguments[0], arguments[1]); return 0; }
+
+static int16_t screenClearScreen(int16_t * arguments)
+{
+	(void)arguments;
+	memset(ram + SCREEN_BASE, 0, (KEYBOARD_ADDRESS - SCREEN_BASE) * sizeof(int16_t));
+
+	return 0;
+}
+
+static int16_t screenDrawLine(int16_t * arguments)
+{
+	int x = arguments[0], y = arguments[1];
+	int dx = abs(arguments[2] - x), dy = -abs(arguments[3] - y);
+	int stepX = x < arguments[2] ? 1 : -1, stepY = y < arguments[3] ? 1 : -1;
+	int error = dx + dy;
+
+	for(;;) {
+		drawPixel(x, y);
+
+		if(x == arguments[2] && y == arguments[3])
+			break;
+
+		int doubled = 2 * error;
+
+		if(doubled >= dy) {
+			error += dy;
+			x += stepX;
+		}
+
+		if(doubled <= dx) {
+			error += dx;
+			y += stepY;
+		}
+	}
+
+	return 0;
+}
+
+static int16_t screenDrawRectangle(int16_t * arguments)
+{
+	if(arguments[0] > arguments[2] || arguments[1] > arguments[3])
+		nativeError(9);
+
+	for(int y = arguments[1]; y <= arguments[3]; y++)
+		drawHorizontalLine(arguments[0], arguments[2], y);
+
+	return 0;
+}
+
+static int16_t screenDrawCircle(int16_t * arguments)
+{
+	int radius = arguments[2];
+
+	if(radius < 0 || radius > 181)
+		nativeError(13);
+
+	for(int dy = -radius; dy <= radius; dy++) {
+		int16_t square = radius * radius - dy * dy;
+		int16_t half = mathSqrt(&square);
+
+		drawHorizontalLine(arguments[0] - half, arguments[0] + half, arguments[1] + dy);
+	}
+
+	return 0;
+}
+
+/* Keyboard */
+
+static int16_t keyboardInit(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t keyboardKeyPressed(int16_t * arguments) { (void)arguments; return ram[KEYBOARD_ADDRESS]; }
+
+static int16_t keyboardReadChar(int16_t * arguments)
+{
+	int c = getchar();
+
+	(void)arguments;
+
+	return c == EOF ? 0 : c == '\n' ? 128 : c;
+}
+
+static int16_t keyboardReadLine(int16_t * arguments)
+{
+	int16_t string;
+	int16_t capacity = MAX_INPUT_SIZE;
+	int c;
+
+	printString(arguments[0]);
+	fflush(stdout);
+
+	string = stringNew(&capacity);
+
+	while((c = getchar()) != EOF && c != '\n')
+		if(ram[string + STRING_LENGTH] < MAX_INPUT_SIZE)
+			ram[string + STRING_CHARS + ram[string + STRING_LENGTH]++] = c;
+
+	return string;
+}
+
+static int16_t keyboardReadInt(int16_t * arguments)
+{
+	int16_t string = keyboardReadLine(arguments);
+	int16_t value = stringIntValue(&string);
+
+	deallocate(string);
+
+	return value;
+}
+
+/* Sys */
+
+static int16_t sysInit(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t sysWait(int16_t * arguments) { (void)arguments; return 0; }
+static int16_t sysHalt(int16_t * arguments) { (void)arguments; running = false; return 0; }
+static int16_t sysError(int16_t * arguments) { nativeError(arguments[0]); return 0; }
+
+static nativeEntry nativeFunctions[] = {
+	{ "Array.new", 1, arrayNew },
+	{ "Array.dispose", 1, memoryDeAlloc },
+	{ "Keyboard.init", 0, keyboardInit },
+	{ "Keyboard.keyPressed", 0, keyboardKeyPressed },
+	{ "Keyboard.readChar", 0, keyboardReadChar },
+	{ "Keyboard.readLine", 1, keyboardReadLine },
+	{ "Keyboard.readInt", 1, keyboardReadInt },
+	{ "Math.init", 0, mathInit },
+	{ "Math.abs", 1, mathAbs },
+	{ "Math.multiply", 2, mathMultiply },
+	{ "Math.divide", 2, mathDivide },
+	{ "Math.min", 2, mathMin },
+	{ "Math.max", 2, mathMax },
+	{ "Math.sqrt", 1, mathSqrt },
+	{ "Memory.init", 0, memoryInit },
+	{ "Memory.peek", 1, memoryPeek },
+	{ "Memory.poke", 2, memoryPoke },
+	{ "Memory.alloc", 1, memoryAlloc },
+	{ "Memory.deAlloc", 1, memoryDeAlloc },
+	{ "Output.init", 0, outputInit },
+	{ "Output.moveCursor", 2, outputMoveCursor },
+	{ "Output.printChar", 1, outputPrintChar },
+	{ "Output.printString", 1, outputPrintString },
+	{ "Output.printInt", 1, outputPrintInt },
+	{ "Output.println", 0, outputPrintln },
+	{ "Output.backSpace", 0, outputBackSpace },
+	{ "Screen.init", 0, screenInit },
+	{ "Screen.clearScreen", 0, screenClearScreen },
+	{ "Screen.setColor", 1, screenSetColor },
+	{ "Screen.drawPixel", 2, screenDrawPixel },
+	{ "Screen.drawLine", 4, screenDrawLine },
+	{ "Screen.drawRectangle", 4, screenDrawRectangle },
+	{ "Screen.drawCircle", 3, screenDrawCircle },
+	{ "String.new", 1, stringNew },
+	{ "String.dispose", 1, memoryDeAlloc },
+	{ "String.length", 1, stringLength },
+	{ "String.charAt", 2, stringCharAt },
+	{ "String.setCharAt", 3, stringSetCharAt },
+	{ "String.appendChar", 2, stringAppendChar },
+	{ "String.eraseLastChar", 1, stringEraseLastChar },
+	{ "String.intValue", 1, stringIntValue },
+	{ "String.setInt", 2, stringSetInt },
+	{ "String.newLine", 0, stringNewLine },
+	{ "String.backSpace", 0, stringBackSpace },
+	{ "String.doubleQuote", 0, stringDoubleQuote },
+	{ "Sys.init", 0, sysInit },
+	{ "Sys.halt", 0, sysHalt },
+	{ "Sys.wait", 1, sysWait },
+	{ "Sys.error", 1, sysError }
+};
+
+nativeEntry * lookupNative(const char * name)
+{
+	for(unsigned int i = 0; i < sizeof(nativeFunctions) / sizeof(nativeEntry); i++)
+		if(!strcmp(nativeFunctions[i].name, name))
+			return &nativeFunctions[i];
+
+	return NULL;
+}
+
+static int lookupProgramFunction(const char * name)
+{
+	int function = lookupFunction(name);
+
+	return function >= 0 && functions[function].hasBody ? function : -1;
+}
+
+void initNativeOS()
+{
+	freeList = HEAP_BASE;
+	ram[HEAP_BASE] = HEAP_END - HEAP_BASE;
+	ram[HEAP_BASE + 1] = 0;
+	screenColour = true;
+
+	/* Both halves of the allocator have to come from the program, a freed block has to go back to the allocator it came from */
+
+	programAlloc = lookupProgramFunction("Memory.alloc");
+	programDeAlloc = lookupProgramFunction("Memory.deAlloc");
+
+	if(programAlloc < 0 || programDeAlloc < 0)
+		programAlloc = programDeAlloc = -1;
+
+	return;
+}
+
+void initProgramOS()
+{
+	static const char * const initialisers[] = { "Memory.init", "Math.init", "Screen.init", "Output.init", "Keyboard.init" };
+	int function;
+
+	/* In the order Sys.init of the Jack OS calls them, the allocator first since the others may allocate */
+
+	for(unsigned int i = 0; i < sizeof(initialisers) / sizeof(initialisers[0]); i++)
+		if((function = lookupProgramFunction(initialisers[i])) >= 0)
+			callProgram(function, NULL, 0);
+
+	return;
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+#include <errno.h>
+#include <poll.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/jack.h"
+#include "../include/jlex.h"
+#include "../include/jparse.h"
+#include "../include/jsym.h"
+#include "../include/jgen.h"
+#include "../include/jopt.h"
+#include "../include/jwatch.h"
+
+extern classList classes;
+extern classSymbolTable * currentClass;
+extern statement * curStatement;
+extern unsigned long outputsReplaced;
+
+static watchedDirectory * watches = NULL;
+static sourceChange * changes = NULL;
+static sourceChange * lastChange = NULL;
+
+static char * copyPath(const char * path)
+{
+	char * copy;
+
+	if(!path)
+		return NULL;
+
+	if(!(copy = calloc(strlen(path) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	return strcpy(copy, path);
+}
+
+int watchSources(compileJob * jobs, char ** paths, int pathCount)
+{
+	int notifier;
+	struct pollfd event;
+
+	/* Every class is kept across builds, so errors are reported and recovered from instead of ending the compiler */
+
+	options.replaceChanged = true;
+	diagnosticHook = reportDiagnostic;
+
+	if((notifier = inotify_init1(IN_CLOEXEC)) < 0) {
+		fprintf(stderr, "Error: Could not start watching for changes!\n");
+		return FILE_ERROR;
+	}
+
+	for(int i = 0; i < pathCount; i++)
+		addWatch(notifier, paths[i]);
+
+	for(compileJob * curJob = jobs; curJob; curJob = curJob->nextJob)
+		recordChange(curJob->sourcePath, curJob->outputDirectory);
+
+	rebuildChanged(true);
+
+	event.fd = notifier;
+	event.events = POLLIN;
+
+	printf("[+] Watching for changes...\n");
+	fflush(stdout);
+
+	for(;;) {
+		if(poll(&event, 1, -1) < 0 && errno != EINTR)
+			break;
+
+		/* A burst of events is collected until the files have been quiet for a moment, then everything it touched is built at once */
+
+		do {
+			readEvents(notifier);
+		} while(poll(&event, 1, WATCH_DEBOUNCE_MS) > 0);
+
+		if(!changes) /* Only other files changed, such as the outputs just written */
+			continue;
+
+		rebuildChanged(false);
+
+		printf("[+] Watching for changes...\n");
+		fflush(stdout);
+	}
+
+	close(notifier);
+	freeWatches();
+	diagnosticHook = NULL;
+
+	return FILE_ERROR;
+}
+
+void addWatch(int notifier, const char * path)
+{
+	watchedDirectory * curWatch;
+	struct stat status;
+	char * directory;
+	char * slash;
+
+	if(!(curWatch = calloc(1, sizeof(watchedDirectory)))) {
+		fprintf(stderr, "Error: Could not allocate memory for watch!\n");
+		exit(MEM_ERROR);
+	}
+
+	curWatch->path = copyPath(path);
+
+	/* A single file is watched through its directory, and keeps writing to the current directory like when it is compiled once */
+
+	if(!stat(path, &status) && S_ISDIR(status.st_mode)) {
+		directory = copyPath(path);
+		curWatch->outputDirectory = copyPath(options.outputDirectory ? options.outputDirectory : path);
+	} else {
+		if((slash = strrchr(path, '/'))) {
+			directory = copyPath(path);
+			directory[slash - path + (slash == path)] = '\0';
+		} else {
+			directory = copyPath(".");
+		}
+
+		curWatch->fileName = copyPath(slash ? slash + 1 : path);
+		curWatch->outputDirectory = copyPath(options.outputDirectory);
+	}
+
+	if((curWatch->descriptor = inotify_add_watch(notifier, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE)) < 0) {
+		fprintf(stderr, "Error: Could not watch \'%s\'!\n", directory);
+		exit(FILE_ERROR);
+	}
+
+	free(directory);
+
+	curWatch->nextDirectory = watches;
+	watches = curWatch;
+
+	return;
+}
+
+void readEvents(int notifier)
+{
+	char buffer[WATCH_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event * event;
+	ssize_t length;
+
+	if((length = read(notifier, buffer, sizeof(buffer))) <= 0)
+		return;
+
+	for(char * position = buffer; position < buffer + length; position += sizeof(struct inotify_event) + event->len) {
+		size_t nameLength;
+
+		event = (const struct inotify_event *)position;
+
+		if(!event->len || (nameLength = strlen(event->name)) < 6 || strcmp(event->name + nameLength - 5, ".jack"))
+			continue;
+
+		/* Paths are built the same way as when the sources were first found, so they match the file names of the classes */
+
+		for(watchedDirectory * curWatch = watches; curWatch; curWatch = curWatch->nextDirectory) {
+			char * path;
+
+			if(curWatch->descriptor != event->wd || (curWatch->fileName && strcmp(curWatch->fileName, event->name)))
+				continue;
+
+			if(curWatch->fileName) {
+				recordChange(curWatch->path, curWatch->outputDirectory);
+				continue;
+			}
+
+			if(!(path = calloc(strlen(curWatch->path) + nameLength + 2, 1))) {
+				fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+				exit(MEM_ERROR);
+			}
+
+			sprintf(path, "%s/%s", curWatch->path, event->name);
+			recordChange(path, curWatch->outputDirectory);
+			free(path);
+		}
+	}
+
+	return;
+}
+
+void recordChange(const char * path, const char * changeOutputDirectory)
+{
+	sourceChange * curChange;
+
+	for(curChange = changes; curChange; curChange = curChange->nextChange)
+		if(!strcmp(curChange->path, path))
+			return;
+
+	if(!(curChange = calloc(1, sizeof(sourceChange)))) {
+		fprintf(stderr, "Error: Could not allocate memory for change!\n");
+		exit(MEM_ERROR);
+	}
+
+	curChange->path = copyPath(path);
+	curChange->outputDirectory = copyPath(changeOutputDirectory);
+
+	if(!lastChange) {
+		changes = lastChange = curChange;
+	} else {
+		lastChange->nextChange = curChange;
+		lastChange = curChange;
+	}
+
+	return;
+}
+
+static bool isAffected(classSymbolTable * curClass, char ** names, unsigned int nameCount)
+{
+	for(unsigned int i = 0; i < nameCount; i++)
+		if(!strcmp(curClass->name, names[i]) || referencesClass(curClass, names[i]))
+			return true;
+
+	return false;
+}
+
+void rebuildChanged(bool everything)
+{
+	jmp_buf recovery;
+	struct timespec start, end;
+	char ** volatile names = NULL; /* Classes whose definition changed, under their old and their new name */
+	unsigned int nameCount = 0;
+	classSymbolTable ** affected;
+	unsigned int classCount = 0;
+	unsigned int volatile affectedCount = 0;
+	unsigned int volatile builtCount = 0;
+	unsigned long previousOutputs = outputsReplaced;
+	sourceChange * nextChange;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(sourceChange * curChange = changes; curChange; curChange = nextChange) {
+		classSymbolTable * oldClass = lookupClassFile(curChange->path);
+		FILE * file;
+
+		nextChange = curChange->nextChange;
+
+		if(!(names = realloc(names, (nameCount + 2) * sizeof(char *)))) {
+			fprintf(stderr, "Error: Could not allocate memory for class names!\n");
+			exit(MEM_ERROR);
+		}
+
+		if(!(file = fopen(curChange->path, "r"))) { /* Deleted or renamed, classes using it now fail to build */
+			if(oldClass) {
+				names[nameCount++] = copyPath(oldClass->name);
+				removeClass(oldClass);
+			}
+		} else {
+			if(oldClass) /* The name is only needed if the class gets replaced, which frees it */
+				names[nameCount] = copyPath(oldClass->name);
+
+			sourceFileName = curChange->path;
+			outputDirectory = curChange->outputDirectory;
+			loadSource(file);
+
+			if(reparseClass()) {
+				nameCount += oldClass != NULL;
+				names[nameCount++] = copyPath(classes.lastClass->name);
+			} else if(oldClass) {
+				free(names[nameCount]);
+			}
+
+			freeSource();
+			fclose(file);
+			sourceFileName = outputDirectory = NULL;
+		}
+
+		free(curChange->path);
+		free(curChange->outputDirectory);
+		free(curChange);
+	}
+
+	changes = lastChange = NULL;
+
+	/* Only the changed classes and the classes which looked any of them up are finalised and generated again, all of them before any is generated */
+
+	for(classSymbolTable * curClass = classes.firstClass; curClass; curClass = curClass->nextClass)
+		classCount++;
+
+	if(!(affected = calloc(classCount + 1, sizeof(classSymbolTable *)))) {
+		fprintf(stderr, "Error: Could not allocate memory for class list!\n");
+		exit(MEM_ERROR);
+	}
+
+	errorRecovery = &recovery;
+
+	for(classSymbolTable * volatile curClass = classes.firstClass; curClass; curClass = curClass->nextClass) {
+		if(!everything && !isAffected(curClass, names, nameCount))
+			continue;
+
+		curStatement = NULL;
+
+		if(!setjmp(recovery)) {
+			finaliseClass(curClass);
+			affected[affectedCount++] = curClass;
+		}
+	}
+
+	for(unsigned int volatile i = 0; i < affectedCount; i++) {
+		curStatement = NULL;
+
+		if(!setjmp(recovery)) {
+			processClass(affected[i]);
+			builtCount++;
+		} else {
+			abandonClass();
+		}
+	}
+
+	errorRecovery = NULL;
+	currentClass = NULL;
+
+	if(options.inlineThreshold)
+		printInlineReport();
+
+	freeInlineReport();
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("[+] Built %u of %u classes in %.1f ms, %lu file%s written\n", builtCount, classCount, ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9) * 1000, outputsReplaced - previousOutputs, outputsReplaced - previousOutputs == 1 ? "" : "s");
+
+	for(unsigned int i = 0; i < nameCount; i++)
+		free(names[i]);
+
+	free(names);
+	free(affected);
+
+	return;
+}
+
+void reportDiagnostic(diagnosticSeverity severity, const char * message, int lineNum)
+{
+	/* Parsing knows the file while finalising and generating know the class, in the format editors pick file and line numbers out of */
+
+	const char * fileName = sourceFileName ? sourceFileName : currentClass && currentClass->fileName ? currentClass->fileName : "";
+
+	if(lineNum > 0)
+		fprintf(stderr, "%s:%d: %s: %s\n", fileName, lineNum, severity == severityError ? "error" : "warning", message);
+	else
+		fprintf(stderr, "%s: %s: %s\n", fileName, severity == severityError ? "error" : "warning", message);
+
+	return;
+}
+
+void freeWatches()
+{
+	watchedDirectory * nextWatch;
+
+	for(watchedDirectory * curWatch = watches; curWatch; curWatch = nextWatch) {
+		nextWatch = curWatch->nextDirectory;
+		free(curWatch->path);
+		free(curWatch->fileName);
+		free(curWatch->outputDirectory);
+		free(curWatch);
+	}
+
+	watches = NULL;
+
+	return;
+}
\ No newline at end of file
@@ -1,39 +1,463 @@
+#include <dirent.h>
+#include <errno.h>
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "../include/jack.h"
 #include "../include/jlex.h"
 #include "../include/jparse.h"
 #include "../include/jsym.h"
 #include "../include/jgen.h"
+#include "../include/jopt.h"
+#include "../include/jcost.h"
+#include "../include/jlink.h"
+#include "../include/jlsp.h"
+#include "../include/jwatch.h"
 
 FILE * sourceFile;
+char * sourceFileName = NULL;
+char * outputDirectory = NULL;
+
+static compileJob * firstJob = NULL;
+static compileJob * lastJob = NULL;
+compilerOptions options = { .intrinsics = true, .maxErrors = DEFAULT_MAX_ERRORS };
 extern classSymbolTable * classes;
 extern int lineNum;
+extern unsigned long tokenCount;
+extern unsigned long parseNodeCount;
+
+static bool languageServer = false;
+static bool watchMode = false;
+
+static const struct option longOptions[] = {
+	{ "array-base", no_argument, NULL, 'a' },
+	{ "cost-report", required_argument, NULL, 'c' },
+	{ "dump-tokens", no_argument, NULL, 'd' },
+	{ "inline", optional_argument, NULL, 'i' },
+	{ "lex-only", no_argument, NULL, 'x' },
+	{ "lsp", no_argument, NULL, 'S' },
+	{ "max-errors", required_argument, NULL, 'E' },
+	{ "licm", no_argument, NULL, 'l' },
+	{ "link", required_argument, NULL, 'k' },
+	{ "output", required_argument, NULL, 'o' },
+	{ "no-intrinsics", no_argument, NULL, 'n' },
+	{ "pack-locals", no_argument, NULL, 'p' },
+	{ "parse-only", no_argument, NULL, 'y' },
+	{ "pool-strings", no_argument, NULL, 's' },
+	{ "profile", no_argument, NULL, 'r' },
+	{ "sized-alloc", no_argument, NULL, 'A' },
+	{ "source-map", no_argument, NULL, 'm' },
+	{ "tail-calls", no_argument, NULL, 't' },
+	{ "watch", no_argument, NULL, 'w' },
+	{ "emit", required_argument, NULL, 'e' },
+	{ "help", no_argument, NULL, 'h' },
+	{ NULL, 0, NULL, 0 }
+};
+
+static void printUsage(FILE * stream, const char * programName)
+{
+	fprintf(stream, "Usage: ./%s [options] [input files or directories]\n\n", programName);
+	fprintf(stream, "Options:\n");
+	fprintf(stream, "  -O\t\t\tEnable all optimisations\n");
+	fprintf(stream, "  --array-base\t\tAddress neighbouring array elements through the current that base\n");
+	fprintf(stream, "  --cost-report=FILE\tWrite estimated ROM size and cycles of every function to FILE as JSON\n");
+	fprintf(stream, "  --dump-tokens\t\tPrint the token stream of every file and stop after lexing\n");
+	fprintf(stream, "  --emit=FORMAT\t\tWrite classes as \"text\" .vm files (default) or \"bytecode\" .vmb files\n");
+	fprintf(stream, "  --inline[=N]\t\tInline subroutines whose body has at most N terms (default %d)\n", DEFAULT_INLINE_THRESHOLD);
+	fprintf(stream, "  --lex-only\t\tStop after lexing and report the number of tokens per second\n");
+	fprintf(stream, "  --licm\t\tHoist loop-invariant computations out of while loops\n");
+	fprintf(stream, "  --link=FILE\t\tLink the whole program into FILE, Hack assembly if it ends in .asm, bytecode if in .vmb\n");
+	fprintf(stream, "  --lsp\t\t\tRun as a language server on stdin and stdout, reporting diagnostics for the given sources\n");
+	fprintf(stream, "  --max-errors=N\tStop after N syntax and semantic errors, 0 for no limit (default %d)\n", DEFAULT_MAX_ERRORS);
+	fprintf(stream, "  --no-intrinsics\tCall Memory.peek/poke and Math.abs/min/max instead of expanding them, for programs with their own OS\n");
+	fprintf(stream, "  -o, --output=DIR\tWrite all .vm files to DIR instead of next to their sources\n");
+	fprintf(stream, "  --pack-locals\t\tShare local slots between variables with disjoint lifetimes\n");
+	fprintf(stream, "  --parse-only\t\tStop after parsing and report the number of parse tree nodes per second\n");
+	fprintf(stream, "  --pool-strings\tBuild identical string literals of a class only once\n");
+	fprintf(stream, "  --profile\t\tAnnotate the output with source lines for the jvm profiler\n");
+	fprintf(stream, "  --sized-alloc\t\tAllocate objects of N fields with Memory.allocN where the Memory class defines it\n");
+	fprintf(stream, "  --source-map\t\tWrite a .vm.map file mapping VM instructions to source lines\n");
+	fprintf(stream, "  --tail-calls\t\tReplace self-recursive tail calls with jumps\n");
+	fprintf(stream, "  --watch\t\tKeep running and rebuild the classes affected whenever a source file changes\n");
+	fprintf(stream, "  -h, --help\t\tDisplay this message\n");
+}
+
+static void parseOptions(int argc, char * argv[])
+{
+	int option;
+
+	while((option = getopt_long(argc, argv, "Oho:", longOptions, NULL)) != -1) {
+		switch(option) {
+			case 'O':
+				options.inlineThreshold = DEFAULT_INLINE_THRESHOLD;
+				options.hoistInvariants = true;
+				options.packLocals = true;
+				options.trackArrayBase = true;
+				options.eliminateTailCalls = true;
+				options.sizedAlloc = true;
+				break;
+			case 'A':
+				options.sizedAlloc = true;
+				break;
+			case 'a':
+				options.trackArrayBase = true;
+				break;
+			case 'c':
+				options.costReportFile = optarg;
+				break;
+			case 'd':
+				options.dumpTokens = options.lexOnly = true;
+				break;
+			case 'i':
+				options.inlineThreshold = optarg ? atoi(optarg) : DEFAULT_INLINE_THRESHOLD;
+
+				if(options.inlineThreshold < 0) {
+					fprintf(stderr, "Error: Inline threshold must not be negative!\n");
+					exit(FILE_ERROR);
+				}
+
+				break;
+			case 'l':
+				options.hoistInvariants = true;
+				break;
+			case 'e':
+				if(!strcmp(optarg, "bytecode")) {
+					options.emitBytecode = true;
+				} else if(!strcmp(optarg, "text")) {
+					options.emitBytecode = false;
+				} else {
+					fprintf(stderr, "Error: Unknown output format \"%s\"!\n\n", optarg);
+					printUsage(stderr, argv[0]);
+					exit(FILE_ERROR);
+				}
+
+				break;
+			case 'k':
+				options.linkFile = optarg;
+				break;
+			case 'E':
+				options.maxErrors = atoi(optarg);
+
+				if(options.maxErrors < 0) {
+					fprintf(stderr, "Error: Error limit must not be negative!\n");
+					exit(FILE_ERROR);
+				}
+
+				break;
+			case 'n':
+				options.intrinsics = false;
+				break;
+			case 'o':
+				options.outputDirectory = optarg;
+				break;
+			case 'p':
+				options.packLocals = true;
+				break;
+			case 's':
+				options.poolStrings = true;
+				break;
+			case 'm':
+				options.sourceMap = true;
+				break;
+			case 'r':
+				options.annotateLines = true;
+				break;
+			case 't':
+				options.eliminateTailCalls = true;
+				break;
+			case 'S':
+				languageServer = true;
+				break;
+			case 'w':
+				watchMode = true;
+				break;
+			case 'x':
+				options.lexOnly = true;
+				break;
+			case 'y':
+				options.parseOnly = true;
+				break;
+			case 'h':
+				printUsage(stdout, argv[0]);
+				exit(EXEC_SUCCESS);
+			default:
+				printUsage(stderr, argv[0]);
+				exit(FILE_ERROR);
+		}
+	}
+
+	if(watchMode && (options.linkFile || options.costReportFile)) { /* Both describe the whole program, while a watch only rebuilds part of it */
+		fprintf(stderr, "Warning: --link and --cost-report are ignored with --watch!\n");
+		options.linkFile = options.costReportFile = NULL;
+	}
+
+	if(options.linkFile && options.sourceMap) { /* Source maps index the per-class files, which are not written when linking */
+		fprintf(stderr, "Warning: --source-map is ignored with --link!\n");
+		options.sourceMap = false;
+	}
+
+	if(options.linkFile && options.emitBytecode) { /* The linked image is bytecode when its name ends in .vmb */
+		fprintf(stderr, "Warning: --emit is ignored with --link!\n");
+		options.emitBytecode = false;
+	}
+}
+
+static char * copyPath(const char * path)
+{
+	char * copy;
+
+	if(!path)
+		return NULL;
+
+	if(!(copy = calloc(strlen(path) + 1, 1))) {
+		fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+		exit(MEM_ERROR);
+	}
+
+	return strcpy(copy, path);
+}
+
+static int comparePaths(const void * first, const void * second)
+{
+	return strcmp(*(char * const *)first, *(char * const *)second);
+}
+
+static void enqueueJob(const char * sourcePath, const char * jobOutputDirectory)
+{
+	compileJob * curJob;
+
+	if(!(curJob = calloc(1, sizeof(compileJob)))) {
+		fprintf(stderr, "Error: Could not allocate memory for compile job!\n");
+		exit(MEM_ERROR);
+	}
+
+	curJob->sourcePath = copyPath(sourcePath);
+	curJob->outputDirectory = copyPath(options.outputDirectory ? options.outputDirectory : jobOutputDirectory);
+
+	if(!firstJob) {
+		firstJob = lastJob = curJob;
+	} else {
+		lastJob->nextJob = curJob;
+		lastJob = curJob;
+	}
+
+	return;
+}
+
+static void discoverSources(const char * path)
+{
+	struct stat status;
+	DIR * directory;
+	struct dirent * entry;
+	char ** names = NULL;
+	size_t nameCount = 0;
+
+	if(stat(path, &status)) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", path);
+		exit(FILE_ERROR);
+	}
+
+	/* Explicitly named files keep writing to the current directory, classes found in a directory are written next to their source */
+
+	if(!S_ISDIR(status.st_mode)) {
+		enqueueJob(path, NULL);
+		return;
+	}
+
+	if(!(directory = opendir(path))) {
+		fprintf(stderr, "Error: Could not open directory \'%s\'!\n", path);
+		exit(FILE_ERROR);
+	}
+
+	while((entry = readdir(directory))) {
+		size_t length = strlen(entry->d_name);
+
+		if(length < 6 || strcmp(entry->d_name + length - 5, ".jack"))
+			continue;
+
+		if(!(names = realloc(names, (nameCount + 1) * sizeof(char *))) || !(names[nameCount] = calloc(strlen(path) + length + 2, 1))) {
+			fprintf(stderr, "Error: Could not allocate memory for file name!\n");
+			exit(MEM_ERROR);
+		}
+
+		sprintf(names[nameCount++], "%s/%s", path, entry->d_name);
+	}
+
+	closedir(directory);
+
+	if(!nameCount) {
+		fprintf(stderr, "Error: No .jack files found in \'%s\'!\n", path);
+		exit(FILE_ERROR);
+	}
+
+	/* Sorting keeps the compilation order, and therefore the output, independent of the file system */
+
+	qsort(names, nameCount, sizeof(char *), comparePaths);
+
+	for(size_t i = 0; i < nameCount; i++) {
+		enqueueJob(names[i], path);
+		free(names[i]);
+	}
+
+	free(names);
+
+	return;
+}
+
+static void runJob(compileJob * curJob)
+{
+	printf("[+] Processing \"%s\"...\n", curJob->sourcePath);
+	printf("[-] Opening file...");
+	fflush(stdout);
+
+	if(!(sourceFile = fopen(curJob->sourcePath, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", curJob->sourcePath);
+		exit(FILE_ERROR);
+	}
+
+	sourceFileName = curJob->sourcePath;
+	outputDirectory = curJob->outputDirectory;
+	loadSource(sourceFile);
+
+	printf("Success!\n[-] Parsing...");
+	fflush(stdout);
+
+	/*printf("\n\nResults\n\nToken Name\tToken Type\tLine Number\n");*/
+	
+	parseClass(); /* Generates a parse tree of the current class */
+	puts("Done!");
+	freeSource();
+	fclose(sourceFile);
+
+	sourceFileName = outputDirectory = NULL;
+
+	return;
+}
+
+static double elapsedSeconds(const struct timespec * start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void lexJob(compileJob * curJob)
+{
+	token curToken;
+
+	if(!(sourceFile = fopen(curJob->sourcePath, "r"))) {
+		fprintf(stderr, "Error: Could not open file \'%s\'!\n", curJob->sourcePath);
+		exit(FILE_ERROR);
+	}
+
+	sourceFileName = curJob->sourcePath;
+	loadSource(sourceFile);
+
+	do {
+		getNextToken(&curToken);
+
+		if(options.dumpTokens) {
+			if(curToken.type == keyword || curToken.type == integer || curToken.type == identifier || curToken.type == string)
+				printf("%s:%d\t%s\t%s\n", curJob->sourcePath, curToken.lineNum, tokenTypeNames[curToken.type], curToken.string);
+			else if(curToken.type != terminator)
+				printf("%s:%d\t%s\t%c\n", curJob->sourcePath, curToken.lineNum, tokenTypeNames[curToken.type], curToken.character);
+		}
+
+		syntaxOkay(curToken);
+	} while(curToken.type != terminator);
+
+	tokenCount--; /* The end of file is not a token of the source */
+	freeSource();
+	fclose(sourceFile);
+	sourceFileName = NULL;
+
+	return;
+}
+
+static void freeJobs()
+{
+	compileJob * nextJob;
+
+	for(compileJob * curJob = firstJob; curJob; curJob = nextJob) {
+		nextJob = curJob->nextJob;
+		free(curJob->sourcePath);
+		free(curJob->outputDirectory);
+		free(curJob);
+	}
+
+	firstJob = lastJob = NULL;
+
+	return;
+}
 
 int main(int argc, char * argv[])
 {
-	if(argc > 1) {
-		for(int i = 1; i < argc; i++) {
-			printf("[+] Processing \"%s\"...\n", argv[i]);
-			printf("[-] Opening file...");
-			fflush(stdout);
+	parseOptions(argc, argv);
 
-			if(!(sourceFile = fopen(argv[i], "r"))) {
-				fprintf(stderr, "Error: Could not open file \'%s\'!\n", argv[i]);
-				return FILE_ERROR;
-			}
+	if(languageServer)
+		return runLanguageServer(argv + optind, argc - optind);
+
+	if(options.outputDirectory && mkdir(options.outputDirectory, 0755) && errno != EEXIST) {
+		fprintf(stderr, "Error: Could not create directory \'%s\'!\n", options.outputDirectory);
+		return FILE_ERROR;
+	}
+
+	if(optind < argc) {
+		for(int i = optind; i < argc; i++)
+			discoverSources(argv[i]);
+
+		if(watchMode) {
+			int status = watchSources(firstJob, argv + optind, argc - optind);
+
+			freeJobs();
+
+			return status;
+		}
+
+		if(options.lexOnly) {
+			struct timespec start;
+			double seconds;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			for(compileJob * curJob = firstJob; curJob; curJob = curJob->nextJob)
+				lexJob(curJob);
+
+			seconds = elapsedSeconds(&start);
+			printf("[+] Lexed %lu tokens in %.6f s (%.0f tokens/s, %s scanner)\n", tokenCount, seconds, seconds > 0 ? tokenCount / seconds : 0, scannerName());
+
+			freeJobs();
 
-			printf("Success!\n[-] Parsing...");
-			fflush(stdout);
+			return EXEC_SUCCESS;
+		}
+
+		if(options.parseOnly) {
+			struct timespec start;
+			double seconds;
+
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			for(compileJob * curJob = firstJob; curJob; curJob = curJob->nextJob)
+				runJob(curJob);
 
-			/*printf("\n\nResults\n\nToken Name\tToken Type\tLine Number\n");*/
-			
-			parseClass(); /* Generates a parse tree of the current class */
-			puts("Done!");
-			fclose(sourceFile);
+			seconds = elapsedSeconds(&start);
+			printf("[+] Parsed %lu nodes from %lu tokens in %.6f s (%.0f nodes/s, %.0f tokens/s)\n", parseNodeCount, tokenCount, seconds, seconds > 0 ? parseNodeCount / seconds : 0, seconds > 0 ? tokenCount / seconds : 0);
+
+			freeClasses();
+			freeJobs();
+
+			return errorCount ? errorStatus : EXEC_SUCCESS;
 		}
 
+		for(compileJob * curJob = firstJob; curJob; curJob = curJob->nextJob)
+			runJob(curJob);
+
 		printf("[+] Finalising symbol table...");
 		fflush(stdout);
 
@@ -45,10 +469,35 @@ int main(int argc, char * argv[])
 		generateCode();
 
 		puts("Done!");
+
+		if(!errorCount) { /* The whole program is needed for these, which it is not after an error */
+			if(options.inlineThreshold)
+				printInlineReport();
+
+			if(options.costReportFile) {
+				writeCostReport(options.costReportFile);
+				printf("[+] Cost report written to \"%s\"\n", options.costReportFile);
+			}
+
+			if(options.linkFile) {
+				linkProgram(options.linkFile);
+				printf("[+] Linked program written to \"%s\"\n", options.linkFile);
+			}
+		}
 		
+		freeInlineReport();
+		freeCostReport();
+		freeLinkedProgram();
 		freeClasses();
+		freeJobs();
+
+		if(errorCount) {
+			fprintf(stderr, "\n%u error%s found!\n", errorCount, errorCount == 1 ? "" : "s");
+			return errorStatus;
+		}
 	} else {
-		fprintf(stderr, "Error: No input files given!\n\nUsage: ./%s [input files]\n", argv[0]);
+		fprintf(stderr, "Error: No input files given!\n\n");
+		printUsage(stderr, argv[0]);
 		return FILE_ERROR;
 	}
 
@@ -1,3 +1,4 @@
+#include <setjmp.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,30 +17,82 @@ extern term * curTerm;
 
 extern bool returned;
 
+static bool isStatementKeyword(token currToken)
+{
+	return isKeywordToken(currToken, "var") || isKeywordToken(currToken, "let") || isKeywordToken(currToken, "if") || isKeywordToken(currToken, "while") || isKeywordToken(currToken, "do") || isKeywordToken(currToken, "return");
+}
+
+static bool skipStatement()
+{
+	token currToken;
+	int depth = 0;
+
+	/* Panic mode, tokens are dropped up to the end of the statement or to where the next statement or the end of the block begins, skipping nested blocks whole */
+
+	for(;;) {
+		peekNextToken(&currToken);
+
+		if(currToken.type == terminator || isKeywordToken(currToken, "constructor") || isKeywordToken(currToken, "function") || isKeywordToken(currToken, "method"))
+			return false; /* The subroutine was never closed, only the class can resynchronise */
+
+		if(!depth && ((currToken.type == punctuator && currToken.character == '}') || isStatementKeyword(currToken)))
+			return true;
+
+		getNextToken(&currToken);
+		syntaxOkay(currToken);
+
+		if(currToken.type == punctuator && currToken.character == '{')
+			depth++;
+		else if(currToken.type == punctuator && currToken.character == '}')
+			depth--;
+		else if(!depth && currToken.type == punctuator && currToken.character == ';')
+			return true;
+	}
+}
+
 statement * parseStatement()
 {
 	token currToken;
+	jmp_buf recovery;
+	jmp_buf * previousRecovery = errorRecovery;
+	statement * parsedStatement = NULL;
+
+	/* A statement with an error is dropped, the parser carries on after it to report the errors further on */
+
+	if(!diagnosticHook)
+		errorRecovery = &recovery;
+
+	if(setjmp(recovery)) {
+		errorRecovery = previousRecovery;
+
+		if(!skipStatement())
+			longjmp(*errorRecovery, 1);
+
+		return NULL;
+	}
 
 	peekNextToken(&currToken);
 
 	if(currToken.type != keyword)
 		syntaxError("Statement or \'}\'", currToken);
-	else if(!strcmp(currToken.string, "var"))
-		return parseVarDeclarStatement();
-	else if(!strcmp(currToken.string, "let"))
-		return parseLetStatement();
-	else if(!strcmp(currToken.string, "if"))
-		return parseIfStatement();
-	else if(!strcmp(currToken.string, "while"))
-		return parseWhileStatement();
-	else if(!strcmp(currToken.string, "do"))
-		return parseDoStatement();
-	else if(!strcmp(currToken.string, "return"))
-		return parseReturnStatement();
+	else if(isKeywordToken(currToken, "var"))
+		parsedStatement = parseVarDeclarStatement();
+	else if(isKeywordToken(currToken, "let"))
+		parsedStatement = parseLetStatement();
+	else if(isKeywordToken(currToken, "if"))
+		parsedStatement = parseIfStatement();
+	else if(isKeywordToken(currToken, "while"))
+		parsedStatement = parseWhileStatement();
+	else if(isKeywordToken(currToken, "do"))
+		parsedStatement = parseDoStatement();
+	else if(isKeywordToken(currToken, "return"))
+		parsedStatement = parseReturnStatement();
 	else
 		syntaxError("Statement or \'}\'", currToken);
 
-	return NULL;
+	errorRecovery = previousRecovery;
+
+	return parsedStatement;
 }
 
 statement * parseVarDeclarStatement()
@@ -53,6 +106,7 @@ statement * parseVarDeclarStatement()
 		semanticWarning("Variable declared after statements");
 	
 	syntaxOkay(currToken);
+	parseType();
 	getNextToken(&currToken);
 
 	curVariable = newVariableSymbol();
@@ -79,6 +133,7 @@ statement * parseVarDeclarStatement()
 				getNextToken(&currToken);
 
 				curVariable = newVariableSymbol();
+				curVariable->lineNum = currToken.lineNum;
 				
 				setVariableTypeName(curVariable, currentFunction->lastVariable->typeName);
 
@@ -116,12 +171,7 @@ statement * parseLetStatement()
 	if(currToken.type != identifier)
 		syntaxError("Identifier", currToken);
 
-	if(!(curStatement->target = calloc(strlen(currToken.string) + 1, 1))) {
-		fprintf(stderr, "Error: Cannot allocate memory for variable name!\n");
-		exit(MEM_ERROR);
-	}
-
-	strncpy(curStatement->target, currToken.string, strlen(currToken.string));
+	curStatement->target = copyNodeString(currToken.string);
 
 	syntaxOkay(currToken);
 	getNextToken(&currToken);
@@ -169,6 +219,7 @@ statement * parseIfStatement()
 {
 	token currToken;
 	statement * curStatement;
+	statement * nextStatement;
 
 	curStatement = newStatement(ifStatement);
 
@@ -202,11 +253,13 @@ statement * parseIfStatement()
 		peekNextToken(&currToken);
 
 		if(currToken.type != punctuator && currToken.character != '}') {
-			if(!curStatement->ifStatements) {
-				curStatement->ifStatements = curStatement->lastIfStatement = parseStatement();
+			if(!(nextStatement = parseStatement())) {
+				continue; /* Variable declarations and statements dropped after an error */
+			} else if(!curStatement->ifStatements) {
+				curStatement->ifStatements = curStatement->lastIfStatement = nextStatement;
 			} else {
-				curStatement->lastIfStatement->nextStatement = parseStatement();
-				curStatement->lastIfStatement = curStatement->lastIfStatement->nextStatement;
+				curStatement->lastIfStatement->nextStatement = nextStatement;
+				curStatement->lastIfStatement = nextStatement;
 			}
 		} else {
 			break;
@@ -221,7 +274,7 @@ statement * parseIfStatement()
 	syntaxOkay(currToken);
 	peekNextToken(&currToken);
 
-	if(currToken.type == keyword && !strcmp(currToken.string, "else")) {
+	if(isKeywordToken(currToken, "else")) {
 		getNextToken(&currToken);
 		syntaxOkay(currToken);
 		getNextToken(&currToken);
@@ -235,11 +288,13 @@ statement * parseIfStatement()
 			peekNextToken(&currToken);
 
 			if(currToken.type != punctuator && currToken.character != '}') {
-				if(!curStatement->elseStatements) {
-					curStatement->elseStatements = curStatement->lastElseStatement = parseStatement();
+				if(!(nextStatement = parseStatement())) {
+					continue; /* Variable declarations and statements dropped after an error */
+				} else if(!curStatement->elseStatements) {
+					curStatement->elseStatements = curStatement->lastElseStatement = nextStatement;
 				} else {
-					curStatement->lastElseStatement->nextStatement = parseStatement();
-					curStatement->lastElseStatement = curStatement->lastElseStatement->nextStatement;
+					curStatement->lastElseStatement->nextStatement = nextStatement;
+					curStatement->lastElseStatement = nextStatement;
 				}
 			} else {
 				break;
@@ -261,6 +316,7 @@ statement * parseWhileStatement()
 {
 	token currToken;
 	statement * curStatement;
+	statement * nextStatement;
 
 	curStatement = newStatement(whileStatement);
 
@@ -294,11 +350,13 @@ statement * parseWhileStatement()
 		peekNextToken(&currToken);
 
 		if(currToken.type != punctuator && currToken.character != '}') {
-			if(!curStatement->whileStatements) {
-				curStatement->whileStatements = curStatement->lastWhileStatement = parseStatement();
+			if(!(nextStatement = parseStatement())) {
+				continue; /* Variable declarations and statements dropped after an error */
+			} else if(!curStatement->whileStatements) {
+				curStatement->whileStatements = curStatement->lastWhileStatement = nextStatement;
 			} else {
-				curStatement->lastWhileStatement->nextStatement = parseStatement();
-				curStatement->lastWhileStatement = curStatement->lastWhileStatement->nextStatement;
+				curStatement->lastWhileStatement->nextStatement = nextStatement;
+				curStatement->lastWhileStatement = nextStatement;
 			}
 		} else {
 			break;
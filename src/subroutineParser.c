@@ -24,11 +24,11 @@ void parseSubroutineDeclaration()
 	curFunction = newFunctionSymbolTable();
 	curFunction->lineNum = currToken.lineNum;
 
-	if(!strcmp(currToken.string, "constructor")) {
+	if(isKeywordToken(currToken, "constructor")) {
 		curFunction->type = constructor;
-	} else if(!strcmp(currToken.string, "function")) {
+	} else if(isKeywordToken(currToken, "function")) {
 		curFunction->type = func;
-	} else if(!strcmp(currToken.string, "method")) {
+	} else if(isKeywordToken(currToken, "method")) {
 		curFunction->type = method;
 		curFunction->argumentCount = 1;
 	} else {
@@ -38,7 +38,7 @@ void parseSubroutineDeclaration()
 	syntaxOkay(currToken);
 	peekNextToken(&currToken);
 
-	if(strcmp(currToken.string, "void"))
+	if(!isKeywordToken(currToken, "void"))
 		parseType();
 
 	getNextToken(&currToken);
@@ -135,6 +135,7 @@ void parseParamList()
 			syntaxOkay(currToken);
 
 			curVariable = newVariableSymbol();
+			curVariable->lineNum = currToken.lineNum;
 
 			parseType();
 			getNextToken(&currToken);
@@ -158,23 +159,15 @@ functionCall * parseSubroutineCall()
 {
 	token currToken;
 	functionCall * call;
+	char * qualifiedName;
 
 	getNextToken(&currToken);
 
 	if(currToken.type != identifier)
 		syntaxError("Identifier", currToken);
 
-	if(!(call = calloc(1, sizeof(functionCall)))) {
-		fprintf(stderr, "Error: Could not allocate memory for subroutine call!\n");
-		exit(MEM_ERROR);
-	}
-
-	if(!(call->actionName = calloc(strlen(currToken.string) + 1, 1))) {
-		fprintf(stderr, "Error: Could not allocate memory for subroutine name!\n");
-		exit(MEM_ERROR);
-	}
-
-	strncpy(call->actionName, currToken.string, strlen(currToken.string));
+	call = allocateNode(sizeof(functionCall));
+	call->actionName = copyNodeString(currToken.string);
 	syntaxOkay(currToken);
 	getNextToken(&currToken);
 
@@ -186,12 +179,9 @@ functionCall * parseSubroutineCall()
 			if(currToken.type != identifier)
 				syntaxError("Identifier", currToken);
 
-			if(!(call->actionName = realloc(call->actionName, strlen(call->actionName) + strlen(currToken.string) + 2))) {
-				fprintf(stderr, "Error: Could not allocate memory for subroutine name!\n");
-				exit(MEM_ERROR);
-			}
-
-			snprintf(call->actionName + strlen(call->actionName), strlen(currToken.string) + 2, ".%s", currToken.string);
+			qualifiedName = allocateNode(strlen(call->actionName) + strlen(currToken.string) + 2);
+			sprintf(qualifiedName, "%s.%s", call->actionName, currToken.string);
+			call->actionName = qualifiedName;
 			syntaxOkay(currToken);
 			getNextToken(&currToken);
 		}